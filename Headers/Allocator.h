@@ -0,0 +1,189 @@
+/*
+    GIFLZWLib --
+    This library provides LZW compression and decompression routine for GIF stream compression.
+
+    Author: Arshdeep Singh, copyleft 2017.
+    LZW algorithm was originally created by Abraham Lempel, Jacob Ziv, and Terry Welch.
+
+    Please see "LICENCE" to read the GPL.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#pragma once
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+
+/*
+The memory of the codecs, their dictionaries and the buffers they return comes from an allocator given to their constructors,
+and when none is given(nullptr) it comes from ::malloc as before, so the buffers they return can be ::free(d) as before.
+
+lzw_allocate:	returns "size" bytes of memory, zeroed if "zeroed" is true, or nullptr.
+lzw_reallocate:	grows the memory to new_size bytes and returns it(it may move), only the first "size" bytes are kept, or nullptr in which case the memory is left as it was.
+lzw_release:	gives the memory back, the memory can be nullptr.
+All of them are called with the context of the allocator.
+*/
+typedef void *(*lzw_allocate)(void *context, size_t size, bool zeroed);
+typedef void *(*lzw_reallocate)(void *context, void *memory, size_t size, size_t new_size);
+typedef void(*lzw_release)(void *context, void *memory);
+
+/*
+Type: Structure
+Explanation: An allocator, the functions that hand out memory and the context they are called with.
+*/
+struct lzw_allocator {
+	lzw_allocate allocate;
+	lzw_reallocate reallocate;
+	lzw_release release;
+	void *context;
+};
+
+/*
+Allocates "size" bytes from the allocator, or from ::malloc(::calloc if zeroed) when the allocator is nullptr.
+*/
+inline void *lzw_alloc(const lzw_allocator *allocator, size_t size, bool zeroed = false) {
+	if (allocator == nullptr)
+		return zeroed ? ::calloc(size, 1) : ::malloc(size);
+	return allocator->allocate(allocator->context, size, zeroed);
+}
+
+/*
+Grows the memory to new_size bytes keeping its first "size" bytes, with ::realloc when the allocator is nullptr.
+*/
+inline void *lzw_realloc(const lzw_allocator *allocator, void *memory, size_t size, size_t new_size) {
+	if (allocator == nullptr)
+		return ::realloc(memory, new_size);
+	return allocator->reallocate(allocator->context, memory, size, new_size);
+}
+
+/*
+Gives the memory back to the allocator, or to ::free when the allocator is nullptr.
+The buffers the codecs return must be released this way with the allocator they were given.
+*/
+inline void lzw_free(const lzw_allocator *allocator, void *memory) {
+	if (allocator == nullptr)
+		::free(memory);
+	else
+		allocator->release(allocator->context, memory);
+}
+
+/*
+The size of the chunks the ArenaAllocator takes from ::malloc, an allocation larger than that gets a chunk of its own.
+*/
+#define ARENA_CHUNK_SIZE (1 << 20)
+
+/*
+Every allocation of the arena begins at a multiple of ARENA_ALIGNMENT, same as ::malloc promises.
+*/
+#define ARENA_ALIGNMENT 16
+
+/*
+Type: Structure
+Explanation: A chunk of the ArenaAllocator, the memory handed out follows the structure itself.
+*/
+struct arena_chunk {
+	arena_chunk *next;
+	size_t size
+		, used;
+};
+
+class
+	/*
+	We only need to have __declspec in MSVC++ as in gcc we compile with -fPIC and -shared
+	*/
+#if defined(__GCC__)
+	//We have nothing to do in here but we still have it for completeness.
+#elif defined(_MSC_VER)
+#ifdef EXPORT
+	__declspec(dllexport)
+#else
+	__declspec(dllimport)
+#endif
+#endif
+ArenaAllocator
+{
+private:
+	/*
+	The chunks, the newest first, the allocations are bumped out of the newest chunk only.
+	last and last_size are the newest allocation, which is the only one that can grow where it is.
+	*/
+	arena_chunk *chunks = nullptr;
+	size_t chunk_size;
+	void *last = nullptr;
+	size_t last_size = 0;
+	std::mutex lock;
+	lzw_allocator functions;
+
+	void *bump(size_t size);
+	static void *arena_allocate(void *context, size_t size, bool zeroed);
+	static void *arena_reallocate(void *context, void *memory, size_t size, size_t new_size);
+	static void arena_release(void *context, void *memory);
+public:
+	ArenaAllocator(size_t chunk_size = ARENA_CHUNK_SIZE);
+	~ArenaAllocator();
+	void release_all();
+	size_t used();
+
+	/*
+	Returns the allocator to give to the codecs, it is valid as long as the ArenaAllocator is.
+	*/
+	const lzw_allocator *allocator() {
+		return &functions;
+	}
+};
+
+/*
+The sizes the PoolAllocator keeps, every allocation is rounded up to a power of two from 1<<POOL_MIN_CLASS to 1<<POOL_MAX_CLASS bytes(header included),
+and larger allocations go straight to ::malloc and ::free.
+*/
+#define POOL_MIN_CLASS 6
+#define POOL_MAX_CLASS 22
+
+/*
+The most blocks of each size a thread keeps for later, the blocks released beyond that go back to ::free.
+*/
+#define POOL_CACHED_BLOCKS 8
+
+class
+#if defined(__GCC__)
+#elif defined(_MSC_VER)
+#ifdef EXPORT
+	__declspec(dllexport)
+#else
+	__declspec(dllimport)
+#endif
+#endif
+PoolAllocator
+{
+private:
+	lzw_allocator functions;
+
+	static void *pool_allocate(void *context, size_t size, bool zeroed);
+	static void *pool_reallocate(void *context, void *memory, size_t size, size_t new_size);
+	static void pool_release(void *context, void *memory);
+public:
+	PoolAllocator();
+	static void trim();
+
+	/*
+	Returns the allocator to give to the codecs, it is valid as long as the PoolAllocator is.
+	*/
+	const lzw_allocator *allocator() {
+		return &functions;
+	}
+};
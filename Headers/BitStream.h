@@ -0,0 +1,471 @@
+/*
+    GIFLZWLib --
+    This library provides LZW compression and decompression routine for GIF stream compression.
+
+    Author: Arshdeep Singh, copyleft 2017.
+    LZW algorithm was originally created by Abraham Lempel, Jacob Ziv, and Terry Welch.
+
+    Please see "LICENCE" to read the GPL.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+#include <malloc.h>
+#include <memory.h>
+#include "Allocator.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+typedef unsigned int uint;
+typedef unsigned char uchar;
+typedef unsigned long long ulong64;
+
+/*
+The writer flushes its accumulator whenever it holds at least BIT_FLUSH_WIDTH bits, as codes are at most 32 bits wide
+a 64 bit accumulator never overflows when we flush at 32 bits.
+*/
+#define BIT_FLUSH_WIDTH 32
+
+/*
+The most bytes a GIF sub-block can hold, each sub-block is a length byte followed by that many bytes of the stream,
+and a sub-block of length 0 terminates the stream.
+*/
+#define GIF_SUB_BLOCK_SIZE 255
+
+/*
+Returns the index of the lowest set bit, the value must not be 0.
+*/
+static inline int lowest_bit(ulong64 value)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return (int)index;
+#else
+	return __builtin_ctzll(value);
+#endif
+}
+
+/*
+Type: Class
+Explanation: BitWriter packs variable width LZW codes into a byte stream, least significant bit first as required by GIF.
+---------------
+The old writer(LZWCompress::write_multibyte_buffer) used to "OR" each code into the output one byte at a time, so every code cost
+two to three iterations of a loop, a boundary check per byte and a zeroed output buffer.
+Now we just shift the code into a 64 bit accumulator and once we have a whole 32 bit word in there we store it with a single write,
+so the capacity of the buffer is only checked once per word, which is once per every 2-10 codes depending upon the code width.
+
+		accumulator: [.......unused.......|code 3|code 2|code 1]  ---(32 bits)--->  buffer
+		                                   ^bit_count
+
+buffer:		the output buffer, allocated from the allocator(::malloc when it is nullptr, so the user of the class can ::free it as before), or given by the user with bind.
+size:		the allocated size of the buffer.
+pointer:	the number of bytes that have been flushed to the buffer.
+flushed:	the number of bytes of the stream that were flushed to the buffers before this one, when the stream is written to more than one buffer with bind.
+owned:		false when the buffer was given with bind, such a buffer is never reallocated, so the user must check has_room before writing.
+framed:		when true the stream is split into GIF sub-blocks as it is written, the length byte of a sub-block is kept at block_start
+			and is set once the sub-block is closed, block_fill is the number of bytes in the open sub-block(GIF_SUB_BLOCK_SIZE when none is open).
+*/
+class BitWriter
+{
+public:
+	uchar *buffer = nullptr;
+	int size = 0
+		, pointer = 0;
+	long long flushed = 0;
+	bool owned = true;
+	const lzw_allocator *allocator = nullptr;
+
+	ulong64 accumulator = 0;
+	uchar bit_count = 0;
+
+	bool framed = false;
+	int block_start = -1
+		, block_fill = GIF_SUB_BLOCK_SIZE;
+
+	/*
+	Creates a writer without any buffer, call allocate or bind before writing.
+	*/
+	BitWriter() {}
+
+	/*
+	Allocates the output buffer of the given size.
+	*/
+	explicit BitWriter(int begin_size) {
+		allocate(begin_size);
+	}
+
+	/*
+	Allocates a new output buffer of the given size, that the writer can grow as required.
+	The bits still in the accumulator are kept, so a stream that was being written to the memory given with bind continues in the new buffer.
+	*/
+	void allocate(int begin_size) {
+		flushed += pointer;
+		buffer = (uchar*)lzw_alloc(allocator, begin_size);
+		size = begin_size;
+		pointer = 0;
+		owned = true;
+	}
+
+	/*
+	Points the writer to the memory given by the user, the bits still in the accumulator are kept so the stream continues in the new memory.
+	*/
+	void bind(uchar *memory, int memory_size) {
+		flushed += pointer;
+		buffer = memory;
+		size = memory_size;
+		pointer = 0;
+		owned = false;
+	}
+
+	/*
+	Forgets the buffer and the bits in the accumulator, so the writer can begin a new stream, the framing is kept.
+	The buffer is not freed, as it has been handed to the user.
+	*/
+	void reset() {
+		buffer = nullptr;
+		size =
+			pointer = 0;
+		flushed = 0;
+		owned = true;
+		accumulator = 0;
+		bit_count = 0;
+		block_start = -1;
+		block_fill = GIF_SUB_BLOCK_SIZE;
+	}
+
+	/*
+	Returns the number of bytes it takes to write "bytes" more bytes of the stream, that is with the length bytes of the sub-blocks they begin.
+	*/
+	inline int framed_size(int bytes) {
+		if (!framed) return bytes;
+		int left = GIF_SUB_BLOCK_SIZE - block_fill;
+		return bytes <= left ? bytes : bytes + 1 + (bytes - left - 1) / GIF_SUB_BLOCK_SIZE;
+	}
+
+	/*
+	Returns the number of bits written since the stream began, in all the buffers it was written to, not counting the length bytes of the sub-blocks
+	when the stream is framed(so it is only a position in the stream for an unframed one).
+	*/
+	inline long long position() {
+		return ((flushed + pointer) << 3) + bit_count;
+	}
+
+	/*
+	Returns true if "bits" more bits can be written without running out of the buffer, counting only the whole words that would be flushed.
+	*/
+	inline bool has_room(int bits) {
+		return pointer + framed_size(((bit_count + bits) >> 5) << 2) <= size;
+	}
+
+	/*
+	Returns true if "bits" more bits can be written and then finished, that is with the last partial byte flushed as well,
+	and the terminating sub-block when the stream is framed.
+	*/
+	inline bool has_room_to_finish(int bits) {
+		return pointer + framed_size((bit_count + bits + 7) >> 3) + (framed ? 1 : 0) <= size;
+	}
+
+	/*
+	Writes N bits such that 0<N<=32 to the accumulator, and flushes a whole word to the buffer when available.
+	*/
+	inline void write(uint information, uchar width) {
+		accumulator |= ((ulong64)information) << bit_count;
+		bit_count += width;
+
+		if (bit_count >= BIT_FLUSH_WIDTH) {
+			/*
+			The word is written in one go as long as it fits in the open sub-block, else byte by byte so a new sub-block can be started in between.
+			*/
+			if (framed) {
+				if (block_fill + 4 > GIF_SUB_BLOCK_SIZE) {
+					for (int i = 0; i < 4; i++) {
+						put_framed((uchar)accumulator);
+						accumulator >>= 8;
+					}
+					bit_count -= BIT_FLUSH_WIDTH;
+					return;
+				}
+				block_fill += 4;
+			}
+			if (pointer + 4 > size) reserve(4);
+
+			uchar *out = buffer + pointer;
+			out[0] = (uchar)(accumulator);
+			out[1] = (uchar)(accumulator >> 8);
+			out[2] = (uchar)(accumulator >> 16);
+			out[3] = (uchar)(accumulator >> 24);
+
+			pointer += 4;
+			accumulator >>= BIT_FLUSH_WIDTH;
+			bit_count -= BIT_FLUSH_WIDTH;
+		}
+	}
+
+	/*
+	Writes the first "bits" bits of a least significant bit first stream that begins at "data", a word at a time,
+	so a stream that ends in the middle of a byte can be followed by another one without any padding in between.
+	*/
+	void write_stream(const uchar *data, long long bits) {
+		for (; bits >= BIT_FLUSH_WIDTH; bits -= BIT_FLUSH_WIDTH, data += 4)
+			write((uint)data[0] | ((uint)data[1] << 8) | ((uint)data[2] << 16) | ((uint)data[3] << 24), BIT_FLUSH_WIDTH);
+		for (; bits > 0; bits -= 8, data++)
+			write(bits >= 8 ? *data : (*data & ((1 << bits) - 1)), bits >= 8 ? 8 : (uchar)bits);
+	}
+
+	/*
+	Writes the bits left in the accumulator, padding the last byte with zeroes, and returns the total bytes in the buffer.
+	*/
+	int finish() {
+		int remaining = (bit_count + 7) >> 3;
+		if (pointer + remaining > size) reserve(remaining);
+
+		while (remaining--) {
+			if (framed) put_framed((uchar)accumulator);
+			else buffer[pointer++] = (uchar)accumulator;
+			accumulator >>= 8;
+		}
+		bit_count = 0;
+		accumulator = 0;
+
+		/*
+		The framed stream ends with the last sub-block closed and followed by the terminating sub-block.
+		*/
+		if (framed) {
+			close_block();
+			if (pointer + 1 > size) reserve(1);
+			buffer[pointer++] = 0;
+		}
+		return pointer;
+	}
+
+	/*
+	Writes the whole bytes that are in the accumulator to the buffer, the bits of the last partial byte are kept in the accumulator.
+	The buffer must have room for 4 more bytes, as there are never more than 31 bits in the accumulator, and one more byte may begin a sub-block.
+	*/
+	void flush_bytes() {
+		while (bit_count >= 8) {
+			if (framed) put_framed((uchar)accumulator);
+			else buffer[pointer++] = (uchar)accumulator;
+			accumulator >>= 8;
+			bit_count -= 8;
+		}
+	}
+
+	/*
+	Writes a byte of a framed stream, beginning a new sub-block(with a length byte that is set later) if the open one is full.
+	*/
+	void put_framed(uchar information) {
+		if (block_fill == GIF_SUB_BLOCK_SIZE) {
+			close_block();
+			if (pointer + 2 > size) reserve(2);
+			block_start = pointer++;
+			block_fill = 0;
+		}
+		else if (pointer + 1 > size) reserve(1);
+
+		buffer[pointer++] = information;
+		++block_fill;
+	}
+
+	/*
+	Sets the length byte of the open sub-block, it must be called before the buffer is handed over as the length byte cannot be set after that.
+	So a sub-block can end before it is full, which GIF allows, and the next byte begins a new sub-block.
+	*/
+	void close_block() {
+		if (block_start >= 0)
+			buffer[block_start] = (uchar)block_fill;
+		block_start = -1;
+		block_fill = GIF_SUB_BLOCK_SIZE;
+	}
+
+	/*
+	Makes sure there is space for at least "bytes" more bytes in the buffer.
+	Small buffers are expanded by the factor of 4 while the large buffers are expanded by factor of 2, same as LZWBase::check_to_extend.
+	*/
+	void reserve(int bytes) {
+		if (!owned) return;
+		int new_size = size > 0 ? size : 4;
+		while (new_size < pointer + bytes)
+			new_size <<= (new_size < (1 << 18)) ? 2 : 1;
+		if (new_size == size) return;
+
+		void *memory = lzw_realloc(allocator, buffer, pointer, new_size);
+		if (memory == nullptr) {
+			memory = lzw_alloc(allocator, new_size);
+			::memcpy(memory, buffer, pointer);
+			lzw_free(allocator, buffer);
+		}
+		buffer = (uchar*)memory;
+		size = new_size;
+	}
+};
+
+/*
+Type: Class
+Explanation: BitReader is the counterpart of the BitWriter, it reads the variable width codes back from a least significant bit first stream.
+---------------
+We used to read a code by loading an unaligned "uint" at the byte the code started on, which reads up to three bytes past the end of the input
+and was only correct to step when the codes started at 8 bits.
+Now we keep a 64 bit accumulator that we refill with a single 8 byte load, which is enough for several codes, and we only fall back
+to reading byte by byte for the last 7 bytes of the buffer, so we never touch memory past buffer + size.
+Once the buffer is finished the reader pads the stream with zero bits, so the caller must check remaining_bits() before trusting a code.
+
+buffer:		the input buffer.
+size:		the size of the input buffer.
+pointer:	the number of bytes that have been moved into the accumulator.
+framed:		when true the stream is read from GIF sub-blocks, block_remaining is the number of bytes left in the current sub-block
+			and terminated is set once the terminating sub-block(of length 0) is read.
+*/
+class BitReader
+{
+public:
+	const uchar *buffer = nullptr;
+	int size = 0
+		, pointer = 0;
+
+	ulong64 accumulator = 0;
+	uchar bit_count = 0;
+
+	bool framed = false
+		, terminated = false;
+	int block_remaining = 0;
+
+	BitReader(const uchar *memory, int memory_size) {
+		rebind(memory, memory_size);
+	}
+
+	/*
+	Points the reader to a new buffer, the bits already in the accumulator are kept so a code can continue from the previous buffer,
+	and so is the sub-block we are in, so a sub-block can continue from the previous buffer as well.
+	*/
+	void rebind(const uchar *memory, int memory_size) {
+		buffer = memory;
+		size = memory_size;
+		pointer = 0;
+	}
+
+	/*
+	Points the reader to the beginning of a new stream, unlike rebind() the bits in the accumulator and the sub-block we were in are forgotten, the framing is kept.
+	*/
+	void reset(const uchar *memory, int memory_size) {
+		rebind(memory, memory_size);
+		accumulator = 0;
+		bit_count = 0;
+		terminated = false;
+		block_remaining = 0;
+	}
+
+	/*
+	Tops up the accumulator to at least 56 bits (or until the buffer is finished).
+	-----------------
+	When there are 8 bytes left, we load all 8 bytes at once, shift them above the bits we have, and then only count the whole bytes that fit,
+	the partial byte that sticks out on top is loaded again on the next refill at the very same position so "OR"ing it again does no harm.
+	*/
+	void refill() {
+		if (framed) {
+			refill_framed();
+			return;
+		}
+		if (pointer + 8 <= size) {
+			const uchar *in = buffer + pointer;
+			ulong64 word = (ulong64)in[0]
+				| ((ulong64)in[1] << 8)
+				| ((ulong64)in[2] << 16)
+				| ((ulong64)in[3] << 24)
+				| ((ulong64)in[4] << 32)
+				| ((ulong64)in[5] << 40)
+				| ((ulong64)in[6] << 48)
+				| ((ulong64)in[7] << 56);
+
+			accumulator |= word << bit_count;
+			pointer += (63 - bit_count) >> 3;
+			bit_count |= 56;
+		}
+		else {
+			while (bit_count <= 56 && pointer < size) {
+				accumulator |= ((ulong64)buffer[pointer++]) << bit_count;
+				bit_count += 8;
+			}
+		}
+	}
+
+	/*
+	Tops up the accumulator from a framed stream, skipping the length bytes of the sub-blocks.
+	We only load 8 bytes at once if they are all in the current sub-block, so the partial byte that sticks out on top is never a length byte.
+	*/
+	void refill_framed() {
+		while (bit_count <= 56 && pointer < size && !terminated) {
+			if (block_remaining == 0) {
+				block_remaining = buffer[pointer++];
+				terminated = block_remaining == 0;
+				continue;
+			}
+
+			if (block_remaining >= 8 && pointer + 8 <= size) {
+				const uchar *in = buffer + pointer;
+				ulong64 word = (ulong64)in[0]
+					| ((ulong64)in[1] << 8)
+					| ((ulong64)in[2] << 16)
+					| ((ulong64)in[3] << 24)
+					| ((ulong64)in[4] << 32)
+					| ((ulong64)in[5] << 40)
+					| ((ulong64)in[6] << 48)
+					| ((ulong64)in[7] << 56);
+
+				int taken = (63 - bit_count) >> 3;
+				accumulator |= word << bit_count;
+				pointer += taken;
+				block_remaining -= taken;
+				bit_count |= 56;
+				return;
+			}
+
+			accumulator |= ((ulong64)buffer[pointer++]) << bit_count;
+			bit_count += 8;
+			--block_remaining;
+		}
+	}
+
+	/*
+	Reads N bits such that 0<N<=32 from the stream, if the stream is finished the missing bits are read as 0.
+	*/
+	inline uint read(uchar width) {
+		if (bit_count < width) {
+			refill();
+			if (bit_count < width) bit_count = width;
+		}
+
+		uint information = (uint)(accumulator & ((((ulong64)1) << width) - 1));
+		accumulator >>= width;
+		bit_count -= width;
+		return information;
+	}
+
+	/*
+	Returns the number of bits that are still to be read from the accumulator and the buffer.
+	The length bytes of a framed stream are not known without reading them, so for a framed stream we top up the accumulator first
+	and count only its bits, which is exact once it is less than 56 bits.
+	*/
+	long long remaining_bits() {
+		if (framed) {
+			refill_framed();
+			return bit_count;
+		}
+		return (long long)bit_count + (((long long)(size - pointer)) << 3);
+	}
+};
@@ -0,0 +1,121 @@
+/*
+    GIFLZWLib --
+    This library provides LZW compression and decompression routine for GIF stream compression.
+
+    Author: Arshdeep Singh, copyleft 2017.
+    LZW algorithm was originally created by Abraham Lempel, Jacob Ziv, and Terry Welch.
+
+    Please see "LICENCE" to read the GPL.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+#include "Allocator.h"
+
+typedef unsigned int uint;
+typedef unsigned short ushort;
+typedef unsigned char uchar;
+
+/*
+Type: Class
+Explanation: ChildTable is a dictionary engine specialized for GIF, where codes are at most 12 bits and pixel indices at most 8 bits.
+---------------
+Since there are only 4096 codes and (1<<start_width) characters, the (previous_code, char_code) pair fits in a direct mapped array
+of 4096*(1<<start_width) entries, so a lookup is just an index computation and a load, without any hashing or probing.
+
+children:	children[(previous_code << start_width) | char_code] is the code of the string previous_code + char_code.
+slots:		slots[code] is the index in children that the code was stored at.
+capacity_bits:	the widest start_width the children have room for, reset() only allocates when it is given a wider one.
+
+How do we clear 4096*256 children(2MB) on every clear code?
+We don't, only the children of the codes added since the last clear are set, and slots tells us where they are,
+so the clear zeroes just those children, which is one store per code and never more than 4096 of them.
+We used to leave the stale children in place and check them against slots on every lookup instead, but a stale child
+that looks like a code of the current dictionary makes the check unpredictable, and it made a reused table slower than a new one.
+The children are allocated zeroed, and with ::calloc(the default allocator) the pages we never touch are never even mapped in by the operating system.
+*/
+class ChildTable
+{
+private:
+	ushort *children;
+	uint *slots;
+	const lzw_allocator *allocator;
+	uint capacity_bits
+		, char_bits
+		, char_mask
+		, total_elements
+		, base_elements;
+public:
+	ChildTable(int start_width, const lzw_allocator *allocator = nullptr);
+	~ChildTable();
+	void clear();
+	void reset(int start_width);
+
+	/*
+	Returns the total number of codes in the table, including the implicit root codes and the clear and end_of_information codes.
+	*/
+	inline uint size() {
+		return total_elements;
+	}
+
+	/*
+	Returns the code for the string (previous_code, char), or -1 if it does not exist in the table.
+	The char must fit in start_width bits, as GIF requires, the bits above it are ignored.
+	*/
+	inline int find(char _char, int _preval) {
+		if (_preval < 0) return (uchar)_char & char_mask;
+
+		uint code = children[((uint)_preval << char_bits) | ((uchar)_char & char_mask)];
+		return code != 0 ? (int)code : -1;
+	}
+
+	/*
+	Adds the string (previous_code, char) with the given code to the table, the code is always the next code(size()).
+	*/
+	inline void add(char _char, int _preval, uint code) {
+		uint slot = ((uint)_preval << char_bits) | ((uchar)_char & char_mask);
+		children[slot] = (ushort)code;
+		slots[code] = slot;
+		++total_elements;
+	}
+
+	/*
+	find and add for a table whose start_width is known at compile time(CharBits, which must be the start_width the table was reset to),
+	so the index into the children is computed with a constant shift and mask rather than the ones we keep in char_bits and char_mask.
+	*/
+	template<int CharBits> inline int find_fixed(char _char, int _preval) {
+		if (_preval < 0) return (uchar)_char & ((1 << CharBits) - 1);
+
+		uint code = children[((uint)_preval << CharBits) | ((uchar)_char & ((1 << CharBits) - 1))];
+		return code != 0 ? (int)code : -1;
+	}
+
+	template<int CharBits> inline void add_fixed(char _char, int _preval, uint code) {
+		uint slot = ((uint)_preval << CharBits) | ((uchar)_char & ((1 << CharBits) - 1));
+		children[slot] = (ushort)code;
+		slots[code] = slot;
+		++total_elements;
+	}
+
+	/*
+	Takes up the given code for the string (previous_code, char) the table already has, which the lookahead parsing of LZWCompress does as the decoder adds
+	every string it is given. The string keeps the code it has, as the longer strings were added to that one.
+	*/
+	inline void add_again(char _char, int _preval, uint code) {
+		slots[code] = ((uint)_preval << char_bits) | ((uchar)_char & char_mask);
+		++total_elements;
+	}
+};
@@ -0,0 +1,203 @@
+/*
+    GIFLZWLib --
+    This library provides LZW compression and decompression routine for GIF stream compression.
+
+    Author: Arshdeep Singh, copyleft 2017.
+    LZW algorithm was originally created by Abraham Lempel, Jacob Ziv, and Terry Welch.
+
+    Please see "LICENCE" to read the GPL.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+#include "BitStream.h"
+#include "Allocator.h"
+
+typedef unsigned int uint;
+typedef unsigned short ushort;
+typedef unsigned char uchar;
+typedef unsigned long long ulong64;
+
+/*
+Number of slots in a group, the tags of a group are compared with each other in one go, so it must be the number of bytes in a ulong64.
+*/
+#define COMPACT_GROUP_SIZE 8
+
+/*
+The table keeps twice as many slots as there can be codes, so even a full dictionary leaves half of the slots empty
+and most of the probes end in the first group.
+*/
+#define COMPACT_SLOT_FACTOR 2
+
+/*
+Constants used to compare all 8 tags of a group at once, in a single 64 bit integer.
+*/
+#define COMPACT_LOW_BITS 0x0101010101010101ULL
+#define COMPACT_HIGH_BITS 0x8080808080808080ULL
+
+/*
+Each group records the epoch its tags were written in, and a group whose epoch is not the epoch of the table is empty,
+so the epoch 0(COMPACT_EPOCH_NONE) of the freshly allocated groups is always empty.
+clear() just moves the table to the next epoch, and the groups only have to be wiped once every COMPACT_EPOCH_LIMIT clears when the epoch wraps around.
+*/
+#define COMPACT_EPOCH_NONE 0
+#define COMPACT_EPOCH_LIMIT 0xffff
+
+/*
+Type: Structure
+Explanation: A group of COMPACT_GROUP_SIZE slots, that fits in a single cache line of 64 bytes.
+tags:	one byte per slot, 0 for empty slots, and (0x80 | 7 bits of the hash) for used slots.
+keys:	the packed (previous_code, char_code) key of each slot, see CompactTable::pack_key.
+codes:	the code of the string stored in each slot.
+epoch:	the epoch the tags were written in, the tags of a group from an earlier epoch are all empty, see COMPACT_EPOCH_NONE.
+------------------------------------------------------
+Compared to the hash_struct that keeps a {char, char, uint, uint} record for each slot, the group is a structure of arrays,
+we look at the tags first, and only the keys whose tag matches the tag of the key we are looking for are compared.
+*/
+struct
+#if defined(_MSC_VER)
+	__declspec(align(64))
+#else
+	__attribute__((aligned(64)))
+#endif
+	compact_group {
+	ulong64 tags;
+	uint keys[COMPACT_GROUP_SIZE];
+	ushort codes[COMPACT_GROUP_SIZE];
+	ushort epoch;
+};
+
+/*
+Type: Class
+Explanation: CompactTable is an alternative to the HashTable for code spaces that fit in 16 bits, such as GIF's 4096 codes.
+---------------
+The HashTable starts at 2^19 slots of 12 bytes, which is 6MB, so most of the lookups miss the cache.
+The CompactTable is sized to the real code space instead: 4096 codes need 8192 slots, which is 1024 groups or 64KB.
+
+The key for a string is the (previous_code, char_code) pair packed into a single 32 bit word, and the root strings(previous_code = -1)
+are never stored in the table at all as the code of a root string is always its char_code.
+*/
+class CompactTable
+{
+private:
+	void *group_memory;
+	const lzw_allocator *allocator;
+	compact_group *groups;
+	uint group_mask
+		, group_shift
+		, total_elements
+		, base_elements
+		, epoch;
+
+	/*
+	Returns the tags of the group, which are all empty if they were written before the last clear.
+	*/
+	inline ulong64 group_tags(const compact_group *group) {
+		return group->epoch == epoch ? group->tags : 0;
+	}
+
+	/*
+	Packs the previous_code and char_code in one key, previous_code is offset by one so that no key is ever 0.
+	*/
+	static inline uint pack_key(char _char, int _preval) {
+		return ((uint)(_preval + 1) << 8) | (uchar)_char;
+	}
+
+	/*
+	Fibonacci hashing, the top bits of the product select the group and the 7 bits below them are the tag.
+	*/
+	static inline uint hash_key(uint key) {
+		return key * 2654435769u;
+	}
+public:
+	CompactTable(int start_width, int max_width, const lzw_allocator *allocator = nullptr);
+	~CompactTable();
+	void clear();
+	void reset(int start_width);
+
+	/*
+	Returns the total number of codes in the table, including the implicit root codes and the clear and end_of_information codes.
+	*/
+	inline uint size() {
+		return total_elements;
+	}
+
+	/*
+	Returns the code for the string (previous_code, char), or -1 if it does not exist in the table.
+	*/
+	inline int find(char _char, int _preval) {
+		if (_preval < 0) return (uchar)_char;
+
+		uint key = pack_key(_char, _preval)
+			, hash = hash_key(key)
+			, index = hash >> group_shift;
+		ulong64 pattern = (0x80 | ((hash >> (group_shift - 7)) & 0x7f)) * COMPACT_LOW_BITS;
+
+		while (true) {
+			compact_group *group = groups + index;
+
+			/*
+			"XOR"ing the tags with the pattern turns the matching tags into zero bytes, and then we find all the zero bytes at once.
+			It might report a byte next to a real match as a match too, but that is fine as we compare the keys anyways.
+			*/
+			ulong64 tags = group_tags(group)
+				, difference = tags ^ pattern
+				, matches = (difference - COMPACT_LOW_BITS) & ~difference & COMPACT_HIGH_BITS;
+
+			while (matches) {
+				int slot = lowest_bit(matches) >> 3;
+				if (group->keys[slot] == key)
+					return group->codes[slot];
+				matches &= matches - 1;
+			}
+
+			/*
+			Slots of a group are filled in order and never deleted, so if the group has an empty slot the key cannot be in a later group.
+			*/
+			if (~tags & COMPACT_HIGH_BITS)
+				return -1;
+			index = (index + 1) & group_mask;
+		}
+	}
+
+	/*
+	Adds the string (previous_code, char) with the given code to the table, the string must not already exist in the table.
+	*/
+	inline void add(char _char, int _preval, uint code) {
+		uint key = pack_key(_char, _preval)
+			, hash = hash_key(key)
+			, index = hash >> group_shift;
+		ulong64 tag = 0x80 | ((hash >> (group_shift - 7)) & 0x7f);
+
+		while (true) {
+			compact_group *group = groups + index;
+			if (group->epoch != epoch) {
+				group->tags = 0;
+				group->epoch = (ushort)epoch;
+			}
+			ulong64 empty = ~group->tags & COMPACT_HIGH_BITS;
+			if (empty) {
+				int slot = lowest_bit(empty) >> 3;
+				group->tags |= tag << (slot << 3);
+				group->keys[slot] = key;
+				group->codes[slot] = (ushort)code;
+				break;
+			}
+			index = (index + 1) & group_mask;
+		}
+		++total_elements;
+	}
+};
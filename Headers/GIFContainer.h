@@ -0,0 +1,240 @@
+/*
+    GIFLZWLib --
+    This library provides LZW compression and decompression routine for GIF stream compression.
+
+    Author: Arshdeep Singh, copyleft 2017.
+    LZW algorithm was originally created by Abraham Lempel, Jacob Ziv, and Terry Welch.
+
+    Please see "LICENCE" to read the GPL.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+#include "LZWCompress.h"
+#include "LZWDecompress.h"
+#include "ThreadPool.h"
+#include "Allocator.h"
+
+typedef unsigned char uchar;
+
+/*
+The bytes that begin the blocks of a GIF file.
+*/
+#define GIF_IMAGE_SEPARATOR 0x2C
+#define GIF_EXTENSION_INTRODUCER 0x21
+#define GIF_TRAILER 0x3B
+#define GIF_GRAPHIC_CONTROL_LABEL 0xF9
+#define GIF_APPLICATION_LABEL 0xFF
+
+/*
+GIF allows minimum code sizes from 2 to 8 bits, even the images with only 2 colors use 2 bits.
+*/
+#define GIF_MIN_CODE_SIZE 2
+#define GIF_MAX_CODE_SIZE 8
+
+/*
+The most bytes that come before the LZW stream of a frame: the graphic control extension(8), the image descriptor(10),
+a local color table of 256 colors(768) and the minimum code size(1).
+*/
+#define GIF_FRAME_HEADER_SIZE (8 + 10 + 3 * 256 + 1)
+
+/*
+Type: Structure
+Explanation: Everything we know about a frame of a GIF, filled by the GIFReader as it indexes the frames and given to the GIFWriter to describe a frame.
+---------------
+left, top, width, height:	where the frame is placed on the logical screen.
+interlaced:		the rows of the frame are stored in the 4 pass interlaced order, the GIFReader puts them back in order as it decodes,
+				and the GIFWriter takes them in order and writes them in the 4 passes.
+palette:		the color table of the frame(3 bytes per color), which is the global color table unless the frame has its own.
+palette_colors:	the number of colors in the palette.
+local_palette:	true if the palette is the frame's own color table.
+delay:			the delay after the frame in 1/100th of a second, from the graphic control extension.
+disposal:		the disposal method of the frame, from the graphic control extension.
+transparent_index:	the transparent color index, or -1 if the frame has none.
+min_code_size:	the minimum code size of the LZW stream, it is the start_width of the codecs.
+data, data_size:	the sub-blocks of the LZW stream, including the terminating sub-block, they point into the GIF itself and are never copied.
+*/
+struct gif_frame {
+	int left
+		, top
+		, width
+		, height;
+	bool interlaced;
+	const uchar *palette;
+	int palette_colors;
+	bool local_palette;
+	int delay
+		, disposal
+		, transparent_index;
+	int min_code_size;
+	const uchar *data;
+	int data_size;
+};
+
+/*
+Type: Structure
+Explanation: Memory the GIFWriter puts the rows of an interlaced frame in, in the 4 pass order, before it compresses them.
+---------------
+memory:	the rows in the 4 pass order.
+size:	the size of the memory, it is grown as required and kept for the next frames.
+*/
+struct gif_rows {
+	uchar *memory;
+	int size;
+};
+
+class
+	/*
+	We only need to have __declspec in MSVC++ as in gcc we compile with -fPIC and -shared
+	*/
+#if defined(__GCC__)
+	//We have nothing to do in here but we still have it for completeness.
+#elif defined(_MSC_VER)
+#ifdef EXPORT
+	__declspec(dllexport)
+#else
+	__declspec(dllimport)
+#endif
+#endif
+GIFReader
+{
+private:
+	/*
+	The whole GIF, either mapped in from a file(mapped is true then, and it is unmapped by the destructor) or memory given by the user.
+	*/
+	const uchar *gif = nullptr;
+	long long gif_size = 0;
+	bool mapped = false;
+#if defined(_WIN32)
+	void *mapping = nullptr;
+#endif
+
+	/*
+	Where the index of the frames and the decompressors come from, ::malloc when it is nullptr.
+	*/
+	const lzw_allocator *allocator = nullptr;
+
+	bool valid = false;
+	int screen_width = 0
+		, screen_height = 0
+		, global_colors = 0
+		, loop = -1;
+	const uchar *global_palette = nullptr;
+
+	/*
+	The frames are indexed lazily, scan_offset is where the next block to index begins and scan_finished is set at the trailer(or where the GIF is broken).
+	The graphic control extension applies to the next frame, so it is kept here until we get to that frame.
+	*/
+	MyList<gif_frame> *frames;
+	long long scan_offset = 0;
+	bool scan_finished = false;
+	int pending_delay = 0
+		, pending_disposal = 0
+		, pending_transparent = -1;
+
+	void parse_header();
+	long long skip_sub_blocks(long long offset);
+	bool index_next();
+	bool decode_frame_with(LZWDecompress *decompress, int index, uchar *pixels, int pixels_size);
+	static void decode_frame_task(void *context, int index, int worker);
+public:
+	GIFReader(const char *path, const lzw_allocator *allocator = nullptr);
+	GIFReader(const uchar *memory, long long memory_size, const lzw_allocator *allocator = nullptr);
+	~GIFReader();
+
+	/*
+	Returns false if the GIF could not be opened or it does not begin with a GIF header.
+	*/
+	bool is_valid() {
+		return valid;
+	}
+	int width() {
+		return screen_width;
+	}
+	int height() {
+		return screen_height;
+	}
+
+	int loop_count();
+	const uchar *palette(int *colors);
+	int frame_count();
+	bool frame(int index, gif_frame *description);
+	bool decode_frame(int index, uchar *pixels, int pixels_size);
+	bool decode_frames(ThreadPool *pool, uchar **pixels, const int *pixels_sizes, bool *decoded = nullptr);
+};
+
+class
+#if defined(__GCC__)
+#elif defined(_MSC_VER)
+#ifdef EXPORT
+	__declspec(dllexport)
+#else
+	__declspec(dllimport)
+#endif
+#endif
+GIFWriter
+{
+private:
+	/*
+	The GIF being written, allocated from the allocator and grown as required, the user takes it with acquire_buffer and must release it
+	with lzw_free and the same allocator(::free it when the allocator is nullptr).
+	*/
+	const lzw_allocator *allocator = nullptr;
+	uchar *buffer = nullptr;
+	int size = 0
+		, pointer = 0;
+
+	/*
+	The compressor add_frame resets for each frame, created by the first add_frame for GIF_MAX_CODE_SIZE so it has room for any minimum code size.
+	*/
+	LZWCompress *compress = nullptr;
+
+	/*
+	The compressor of each worker of add_frames, created by the first frame the worker compresses and kept for the next calls, worker_count is
+	the most workers a pool of add_frames had.
+	*/
+	LZWCompress **workers = nullptr;
+	int worker_count = 0;
+
+	/*
+	The memory the rows of the interlaced frames are put in the 4 pass order in before they are compressed, for add_frame and for each worker of add_frames.
+	*/
+	gif_rows rows = { nullptr, 0 };
+	gif_rows *worker_rows = nullptr;
+	int clear_policy = LZW_CLEAR_WHEN_FULL
+		, lookahead = 0;
+	int screen_width
+		, screen_height
+		, global_colors;
+
+	void reserve(int bytes);
+	void put_byte(uchar information);
+	void put_short(int information);
+	void put_palette(const uchar *palette, int colors, int table_colors);
+	int frame_code_size(const gif_frame *frame);
+	int put_frame_header(uchar *out, const gif_frame *frame, int *min_code_size);
+	const uchar *order_rows(gif_rows *rows, const uchar *pixels, const gif_frame *frame);
+	static void encode_frame_task(void *context, int index, int worker);
+public:
+	GIFWriter(int width, int height, const uchar *palette, int colors, int loop_count = -1, const lzw_allocator *allocator = nullptr);
+	~GIFWriter();
+	void set_clear_policy(int clear_policy);
+	void set_lookahead(int codes);
+	bool add_frame(const uchar *pixels, const gif_frame *frame, ThreadPool *pool = nullptr);
+	bool add_frames(ThreadPool *pool, const uchar *const *pixels, const gif_frame *frames, int count);
+	int finish();
+	uchar *acquire_buffer(int *buffer_size);
+};
@@ -23,6 +23,8 @@
 */
 
 #pragma once
+#include "BitStream.h"
+#include "Allocator.h"
 
 /*
 When the hash table is above a certain threshold, we must expand the table, so we expand it to the size <<multiplied>> by the hash_expand.
@@ -43,10 +45,42 @@ but since we are using open addressing we need to expand a bit faster at about 7
 */
 #define HASH_FILL .75
 
+/*
+A table whose codes are bounded by a max width is sized up front to 2^(max_width+1) slots, so it is at most half full and never expands,
+up to tables of 2^HASH_PRESIZE_LIMIT slots(14 bytes a slot), the wider ones start at that size and expand from there.
+*/
+#define HASH_PRESIZE_LIMIT 24
+
 /*
 Can't write 'unsigned int' so now I type 'uint', compression compression everywhere. :)
 */
 typedef unsigned int uint;
+typedef unsigned char uchar;
+typedef unsigned short ushort;
+
+/*
+The tag of a slot is 16 bits, the high byte is the epoch the slot was written in, and the low byte is (0x80 | 7 bits of the hash),
+so a slot whose tag does not match the tag we are looking for cannot be the string we want.
+A slot is empty when its epoch is not the epoch of the table, so the epoch 0(HASH_EPOCH_NONE) of the freshly allocated tags is always empty.
+*/
+#define HASH_EPOCH_NONE 0
+
+/*
+clear() just moves the table to the next epoch, and the tags only have to be zeroed once every HASH_EPOCH_LIMIT clears when the epoch wraps around.
+*/
+#define HASH_EPOCH_LIMIT 0xff
+
+/*
+The first HASH_TAG_MIRROR tags are copied after the last tag, so the probes can load 16 tags at any slot without wrapping around the table.
+*/
+#define HASH_TAG_MIRROR 16
+
+/*
+The probe implementations, select_probe picks the best one the CPU supports at run time.
+*/
+#define HASH_PROBE_SCALAR 0
+#define HASH_PROBE_SSE2 1
+#define HASH_PROBE_AVX2 2
 
 /*
 Type: Structure
@@ -79,23 +113,61 @@ struct hash_struct {
 	uint previous_code;
 };
 
+/*
+Type: Structure
+Explanation: The hash table does not store the hash_struct(s) themselves anymore, but a column of tags and a column of entries.
+tags:			two bytes per slot, see HASH_EPOCH_NONE, replaces the is_valid field.
+entries:		the previous_code, code and char_code of every slot.
+------------------------------------------------------
+So why the columns?
+Because when we look for a string we compare the tags of 8 or 16 slots in one SIMD instruction, and the tags need to be next to each other for that,
+then we only read the entries of the slots whose tag matched.
+*/
+struct hash_entry {
+	uint previous_code;
+	uint code;
+	char char_code;
+};
+
+struct hash_columns {
+	ushort *tags;
+	hash_entry *entries;
+};
+
 class HashTable
 {
 private:
-	hash_struct * hash_memory;
+	hash_columns hash_memory;
+	const lzw_allocator *allocator;
 	uint hash_memory_size
 		, hash_update_size
 		, hash_total_elements
-		, base_reset_size;
+		, base_reset_size
+		, base_elements
+		, epoch;
+
+	/*
+	The probe selected for this CPU, all of them return the slot of the string or -1 and they always find the same slot.
+	*/
+	int (HashTable::*probe)(const hash_columns * columns, uint memory_size, uint index, ushort tag, char _char, uint _preval);
 
 	void expand_table();
+	hash_entry *lookup(char _char, uint _preval);
 	uint get_hashcode(char _char, int _preval, uint modulus);
-	void add_private(hash_struct * source_memory, char _char, int _preval, uint code, char valid);
+	ushort get_tag(char _char, int _preval);
+	bool is_used(ushort tag);
+	void allocate_columns(hash_columns * columns, uint memory_size);
+	void free_columns(hash_columns * columns);
+	void add_private(hash_columns * source_memory, uint memory_size, char _char, int _preval, uint code, ushort tag);
+	int probe_scalar(const hash_columns * columns, uint memory_size, uint index, ushort tag, char _char, uint _preval);
+	int probe_sse2(const hash_columns * columns, uint memory_size, uint index, ushort tag, char _char, uint _preval);
+	int probe_avx2(const hash_columns * columns, uint memory_size, uint index, ushort tag, char _char, uint _preval);
 public:
 	uint size();
 	void clear();
+	void reset(int start_width);
 	~HashTable();
-	HashTable(int computed_size);
+	HashTable(int computed_size, int start_width, const lzw_allocator *allocator = nullptr);
 	/*
 	If we are going to call this function millions of times, hell sure it must be __fastcall in registers
 	*/
@@ -105,6 +177,7 @@ public:
 #endif
 	add(char _char, int _preval, uint code);
 	hash_struct get(char _char, unsigned int _preval);
-	void add_special_codes(char _char, int _preval, uint code);
+	int find(char _char, int _preval);
+	int select_probe(int probe_level);
 };
 
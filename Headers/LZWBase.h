@@ -25,6 +25,8 @@
 #pragma once
 #include "MyList.h"
 #include "HashTable.h"
+#include "CompactTable.h"
+#include "ChildTable.h"
 #include <memory.h>
 
 #ifndef __GCC__
@@ -37,12 +39,18 @@
 /*
 The higher the number the higher the amount of values or keys, the dictionary can support
 Also the dictionary size is related with the formula 1<<MAX_BYTE_LEN integer, example 12 as MAX_BYTE_LEN support dictionary with size of 4096
-The dictionary memory footprint can be calculated with the formula, sizeof(storage_info) which is 12 * size of dictionary
-So the memory footprint then is [[12*(1<<MAX_BYTE_LEN)]] approx.
+The dictionary memory footprint can be calculated with the formula, sizeof(storage_info) which is 16 * size of dictionary
+So the memory footprint then is [[16*(1<<MAX_BYTE_LEN)]] approx.
 The higher the size of items dictionary can support, the lower the dictionar purges and high compression which also slows down processing.
 */
 #define MAX_BYTE_LEN 32 
 
+/*
+GIF does not allow codes wider than 12 bits, so a GIF dictionary never has more than 4096 codes in it.
+Dictionaries that are sized to the real code space (such as the CompactTable) use this value instead of MAX_BYTE_LEN.
+*/
+#define GIF_MAX_BYTE_LEN 12
+
 /*
 DEFAULT_BYTE_LEN is important variable(or it used to be in previous versions), as it defines the size of the input/output buffer's per code data.
 Lower values such as 1 allows one code to have only 2 values, while higher values such as 8 are common for ASCII codes, lower values are only used in binary data
@@ -86,6 +94,73 @@ Thus essentially multiplying by two, this is <<supposed>> to be faster operation
 */
 #define BUFFER_GROW_SIZE 1
 
+/*
+The dictionary engines LZWCompress can use, the engine is chosen when the class is instantiated, they are here so the decompressor can be matched to them.
+HASH_TABLE_ENGINE:		the HashTable, codes grow up to MAX_BYTE_LEN bits.
+COMPACT_TABLE_ENGINE:	the CompactTable, codes grow up to GIF_MAX_BYTE_LEN bits, and the table is sized for 4096 codes only.
+						The output is a valid GIF stream, and it must be decompressed with max_width set to GIF_MAX_BYTE_LEN.
+CHILD_TABLE_ENGINE:		the ChildTable, a direct mapped table for GIF only, codes grow up to GIF_MAX_BYTE_LEN bits and the input bytes
+						must fit in start_width bits, the output is the same as the COMPACT_TABLE_ENGINE's output, just produced faster.
+*/
+enum dictionary_engine {
+	HASH_TABLE_ENGINE = 0,
+	COMPACT_TABLE_ENGINE = 1,
+	CHILD_TABLE_ENGINE = 2
+};
+
+/*
+Returns the widest code the engine writes by default, that is the max_width the decompressor of its streams must be instantiated with,
+a decompressor left at MAX_BYTE_LEN reads the codes of a full GIF dictionary one bit too wide.
+Give it to the constructor of the decompressor, for example LZWDecompress(8, lzw_engine_max_width(COMPACT_TABLE_ENGINE)),
+a compressor narrowed with LZWCompress::set_max_width needs a decompressor of that max_width instead.
+*/
+inline int lzw_engine_max_width(int engine) {
+	return engine == HASH_TABLE_ENGINE ? MAX_BYTE_LEN : GIF_MAX_BYTE_LEN;
+}
+
+/*
+The status returned by the functions that write the output into memory given by the user, and can stop and resume later.
+LZW_DONE:			the whole stream has been processed.
+LZW_NEED_OUTPUT:	the output memory is full, call the function again with more memory to continue from where it stopped.
+LZW_NEED_INPUT:		all the input given so far has been processed, give more input(or finish the stream) to continue.
+LZW_SINK_FAILED:	the sink the output is written to has refused the output, the stream cannot be continued.
+LZW_BAD_CODE:		the decompressor read a code it cannot have, one past the dictionary, such as a code read wider than the stream was written
+					(a max_width that does not match the compressor's, see lzw_engine_max_width) or a broken stream, the output up to it is kept.
+*/
+enum lzw_status {
+	LZW_DONE = 0,
+	LZW_NEED_OUTPUT = 1,
+	LZW_NEED_INPUT = 2,
+	LZW_SINK_FAILED = 3,
+	LZW_BAD_CODE = 4
+};
+
+/*
+How the compressed stream is laid out in memory, set with set_framing on the compressor and the decompressor.
+LZW_FRAMING_NONE:		the codes are one contiguous stream of bytes.
+LZW_FRAMING_SUB_BLOCKS:	the stream is split into GIF sub-blocks of at most 255 bytes that each begin with their length byte,
+						and it ends with the terminating sub-block of length 0, just as the image data of a GIF.
+*/
+enum lzw_framing {
+	LZW_FRAMING_NONE = 0,
+	LZW_FRAMING_SUB_BLOCKS = 1
+};
+
+/*
+Type: Structure
+Explanation: A point of the side index of a stream, one for every clear code in the stream and one more for where the stream ends(the end_of_information code).
+The decoder starts over with an empty dictionary after a clear code, so a stream can be decoded from any of its clear codes on, which is what decompress_parallel does.
+---------------
+bit_offset:		where the code begins, in bits from the beginning of the stream.
+width:			the width the code is written at.
+output_offset:	the number of bytes the codes before it decode to, so for the last point it is the size of the whole output.
+*/
+struct lzw_clear_point {
+	long long bit_offset;
+	int width;
+	long long output_offset;
+};
+
 /*
 Type: Structure
 Explanation: This structure is used as the backbone for the MyList structure, as the MyList is just a huge array<<kind of>> of this structure
@@ -111,6 +186,12 @@ _preval: The previous structure location in the array that this structure is an
 		----------------------
 size_s: for each string we have a size of the string, we store the same property in the structure so we know how many structures come together to form this one string.
 		or how many structures we need to walk to generate our string back.
+first_char: the first character of the string, that is the char_code at the very end of the back references.
+		The decoder needs the first character of a string for every code it reads, and it used to walk all the back references to find it,
+		now it is copied from the previous structure when a structure is pushed. It fits in the padding after char_code so it does not make the structure any larger.
+position: where the string minus its last character can be found in the decoder's output, not used by the root structures.
+		Every string is its previous string plus a character, and the decoder has already written the previous string to the output,
+		so instead of walking the back references a character at a time we copy the previous string from where it was written in one go.
 ---------------
 Why not use classic strings, won't they be faster?
 Ans:In general they are actually pretty fast, but the overhead of moving them around, and allocating memory for them because they are mutable and does not have a
@@ -118,13 +199,16 @@ Ans:In general they are actually pretty fast, but the overhead of moving them ar
 */
 typedef struct {
 	char char_code;
+	char first_char;
 	int previous_code;
 	int size;
+	int position;
 } storage_info;
 
 typedef unsigned int uint;
 typedef unsigned char uchar;
 typedef unsigned short ushort;
+typedef unsigned long long ulong64;
 
 /*
 EXPORT: is defined in the preprocessor settings for only GIFLZWLib, so if we try to include it in other project(s) it builds as __declspec(dllimport)
@@ -139,16 +223,33 @@ class
 #endif
 	LZWBase
 {
-	int byte_default_start = 0;
+protected:
+	int byte_default_start = 0
+		, byte_max_width = MAX_BYTE_LEN; // The codes never grow wider than byte_max_width, and the dictionary is full at (1<<byte_max_width) codes
+	const lzw_allocator *allocator = nullptr; // Where all the memory of the codec comes from, ::malloc when it is nullptr
 public:
-	LZWBase(int start_width = DEFAULT_BYTE_LEN);
+	LZWBase(int start_width = DEFAULT_BYTE_LEN, int max_width = MAX_BYTE_LEN, const lzw_allocator *allocator = nullptr);
 	void *extend_buffer(void *, int, int);
 	void check_to_extend(char **, int *, int);
 	int  read_into_buffer(unsigned char *, int, ::FILE *);
 	void push_default_elements(MyList<storage_info> *);
-	void push_default_elements(HashTable *);
 	bool step_byte_width(MyList<storage_info> *, char *);
-	bool step_byte_width(HashTable * table, uchar * byte_width);
 	void manual_hash_clean(HashTable * table, uchar * byte_width);
+	void manual_hash_clean(CompactTable * table, uchar * byte_width);
+	void manual_hash_clean(ChildTable * table, uchar * byte_width);
+
+	/*
+	2/2: Steps up byte_width when table has more elements than the (1<<byte_width) can store, but never above byte_max_width.
+	contrary to dictionary the hash table has default sizes of huge numbers so we need to call this function with the table's counter for number of elements it contain
+	Returns true when the table is full, the compressor must then write one more code and then the clear code, just like every other GIF encoder does.
+	*/
+	template<class Table> bool step_byte_width(Table * table, uchar * byte_width)
+	{
+		if (table->size() > (((ulong64)1) << (*byte_width))
+			&& *byte_width < this->byte_max_width) {
+			++(*byte_width);
+		}
+		return table->size() >= (((ulong64)1) << this->byte_max_width);
+	}
 };
 
@@ -24,6 +24,110 @@
 
 #pragma once
 #include "LZWBase.h"
+#include "BitStream.h"
+#include "ThreadPool.h"
+
+/*
+The compressor can stop when the output memory is full and resume later, so it keeps track of where it is in the stream.
+COMPRESS_BEGIN:	nothing is written yet, the clear code that begins the stream is next.
+COMPRESS_BODY:	the input is being compressed.
+COMPRESS_END:	the input is finished, the last code and the end_of_information code are next.
+COMPRESS_DONE:	the whole stream has been written.
+*/
+enum compress_stage {
+	COMPRESS_BEGIN = 0,
+	COMPRESS_BODY = 1,
+	COMPRESS_END = 2,
+	COMPRESS_DONE = 3
+};
+
+/*
+What the compressor does once its dictionary is full, that is when it has (1<<byte_max_width) codes, see set_clear_policy.
+LZW_CLEAR_WHEN_FULL:	writes a clear code right away and starts over with an empty dictionary, which is what every GIF encoder does.
+LZW_CLEAR_DEFERRED:		never writes a clear code, the dictionary is frozen and the compressor keeps coding at byte_max_width bits with it,
+						which is best when the rest of the input looks like the input that filled the dictionary.
+LZW_CLEAR_ON_RATIO:		freezes the dictionary the same way, but keeps watching the output bits per input byte over a sliding window of the input,
+						and writes a clear code as soon as the ratio degrades(see ratio_degraded), so a dictionary that still pays off is never rebuilt.
+Any decoder handles all of them, as a decoder with a full dictionary just keeps decoding with it until it reads a clear code.
+*/
+enum lzw_clear_policy {
+	LZW_CLEAR_WHEN_FULL = 0,
+	LZW_CLEAR_DEFERRED = 1,
+	LZW_CLEAR_ON_RATIO = 2
+};
+
+/*
+LZW_CLEAR_ON_RATIO measures the ratio of a frozen dictionary over a window that slides a slot of LZW_RATIO_SLOT input bytes at a time,
+and is LZW_RATIO_SLOTS slots long, so a change of the input shows up within a slot, while the noise of a single slot is averaged out.
+The dictionary is cleared when the window is worse than the ratio it had while it filled up by more than 1/LZW_RATIO_TOLERANCE of it,
+or when the window moves away from the ratio the frozen dictionary settled at by more than 1/LZW_RATIO_SHIFT of it and LZW_RATIO_SHIFT_FLOOR bits per byte.
+*/
+#define LZW_RATIO_SLOT (1 << 9)
+#define LZW_RATIO_SLOTS 4
+#define LZW_RATIO_TOLERANCE 16
+#define LZW_RATIO_SHIFT 4
+#define LZW_RATIO_SHIFT_FLOOR 0.5
+
+/*
+The shortest string of a single repeated byte the compressor skips a run of the input with, see run_top_code.
+*/
+#define LZW_RUN_MIN 4
+
+/*
+The most codes the lookahead parsing(see set_lookahead) looks ahead, how many of the longest prefixes of a match it considers ending the code at,
+and how many bytes more than the length of the longest match a shorter code must get further by(see LZWCompress::choose_code).
+*/
+#define LZW_LOOKAHEAD_MAX 2
+#define LZW_LOOKAHEAD_SPAN 8
+#define LZW_LOOKAHEAD_GAIN 2
+
+/*
+Type: Structure
+Explanation: How the compressor looks up and adds the strings of a dictionary engine, StartWidth is the start_width when it is known at compile time, else 0.
+---------------
+find:		returns the code of the string (previous_code, char), or -1 if the table does not have it.
+add:		adds the string (previous_code, char) with the next code.
+add_again:	takes up the next code for a string the table already has, which the lookahead parsing does.
+Only the ChildTable makes use of StartWidth(see table_ops<ChildTable, StartWidth>), as its index is the code shifted by the start_width.
+*/
+template<class Table, int StartWidth> struct table_ops {
+	static inline int find(Table *table, char _char, int _preval) {
+		return table->find(_char, _preval);
+	}
+	static inline void add(Table *table, char _char, int _preval, uint code) {
+		table->add(_char, _preval, code);
+	}
+	/*
+	Adds a string the table already has, a hash table just keeps it twice, it finds the one its probe comes to first and either code decodes the same.
+	*/
+	static inline void add_again(Table *table, char _char, int _preval, uint code) {
+		table->add(_char, _preval, code);
+	}
+};
+
+template<int StartWidth> struct table_ops<ChildTable, StartWidth> {
+	static inline int find(ChildTable *table, char _char, int _preval) {
+		return StartWidth != 0 ? table->find_fixed<StartWidth>(_char, _preval) : table->find(_char, _preval);
+	}
+	static inline void add(ChildTable *table, char _char, int _preval, uint code) {
+		if (StartWidth != 0) table->add_fixed<StartWidth>(_char, _preval, code);
+		else table->add(_char, _preval, code);
+	}
+	static inline void add_again(ChildTable *table, char _char, int _preval, uint code) {
+		table->add_again(_char, _preval, code);
+	}
+};
+
+/*
+The least input compress_parallel gives a stripe, as every stripe begins with an empty dictionary, smaller stripes lose more of the ratio than they gain in speed.
+*/
+#define LZW_STRIPE_MIN_SIZE (1 << 18)
+
+/*
+The sink the streaming compressor writes its output to, it is called with the context given to the constructor and the bytes of the stream in order.
+It must return true if it took the bytes, if it returns false the stream is abandoned and the streaming functions return LZW_SINK_FAILED.
+*/
+typedef bool(*lzw_sink)(void *context, const uchar *data, int size);
 
 class
 #if defined(_MSC_VER)
@@ -37,52 +141,149 @@ LZWCompress: private LZWBase
 {
 private:
 	/*
-	Buffer where the compressed stream is output to.
+	Writer that packs the codes into the buffer where the compressed stream is output to, its buffer defaults to BUFFER_SIZE.
 	*/
-	uchar *compression_buffer;
+	BitWriter writer;
+
+	uchar byte_width = 0 // The width of the LZW codes that we will output to the writer
+		, default_byte_width = 0; // The byte width that "byte_width" must be reset to once it is above MAX_BYTE_LEN
+
+#ifdef FILE_READ_BUILD
+	std::FILE *file_in; // The handle to the file that the library is compressing, nullptr for the streaming compressor
+	uchar file_buffer[BUFFER_SIZE]; // The chunk of the file that we are compressing
+	long file_size = 0; // Used to track the size of the file the program is processing
+#endif
+	const uchar *buffer; // buffer is the actual data that we are compressing
+
+	int buffer_size // used to track the size of the buffer, so that we can terminate the program when done
+		, buffer_pointer = 0; // used to track the processing state of the buffer, which tells us about what next code to process
 
 	/*
-	The size of the above buffer, defaults to BUFFER_SIZE
+	The state of the compression that must survive when we stop for more output memory, see compress_stage.
 	*/
-	int compression_buffer_size = BUFFER_SIZE;
+	int stage = COMPRESS_BEGIN
+		, previous_code = -1;
+	bool table_full = false;
+#ifdef FILE_READ_BUILD
+	long iterate = 0;
+#endif
 
 	/*
-	The pointer to track location of the bufferat which we are going to write next values
+	What we do once the dictionary is full, see lzw_clear_policy.
+	For LZW_CLEAR_ON_RATIO, clear_bits and clear_input are where the dictionary began in the output and in the input, slot_bits and slot_input where the slot
+	being measured began. The output bits and input bytes of the slots of the window are in a ring, with their sums in window_bits and window_input,
+	fill_ratio is the output bits per input byte it took the dictionary to fill up, and settled_ratio the ratio of the frozen dictionary,
+	a running average of its whole windows that begins at the fill_ratio.
 	*/
-	int compression_buffer_pointer = 0;
+	int clear_policy = LZW_CLEAR_WHEN_FULL;
+	long long clear_bits = 0
+		, clear_input = 0
+		, slot_bits = 0
+		, slot_input = 0
+		, window_bits = 0
+		, window_input = 0;
+	long long ring_bits[LZW_RATIO_SLOTS]
+		, ring_input[LZW_RATIO_SLOTS];
+	int ring_count = 0
+		, ring_next = 0;
+	double fill_ratio = 0
+		, settled_ratio = 0;
 
 	/*
-	bit_pointer is used to keep track of bit inside a byte as we write a value that overlaps byte boundary
+	The longest string of a single repeated byte in the dictionary, for each byte: its code and its length.
+	The strings of a repeated byte are added one byte longer at a time, so all the shorter ones are in the dictionary as well,
+	and a run of the input that is at least as long as the longest one is matched to it without looking up every byte of it.
 	*/
-	uchar bit_pointer = 0
-		, byte_width = 0 // The width of the LZW codes that we will output to the compression_buffer
-		, default_byte_width = 0; // The byte width that "byte_width" must be reset to once it is above MAX_BYTE_LEN
+	int run_top_code[256]
+		, run_top_length[256];
 
-#ifdef FILE_READ_BUILD
-	std::FILE *file_in; // The handle to the file that the library is compressing
-	uchar buffer[BUFFER_SIZE]; // buffer is the actual data that we are compressing
-	long file_size = 0; // Used to track the size of the file the program is processing
-#else
-	uchar *buffer;
-#endif
+	/*
+	The codes of lookahead the parsing does, 0 for the greedy parsing, see set_lookahead.
+	*/
+	int lookahead = 0;
 
-	int buffer_size // used to track the size of the buffer, so that we can terminate the program when done
-		, buffer_pointer = 0; // used to track the processing state of the buffer, which tells us about what next code to process
+	/*
+	The streaming compressor takes its input a chunk at a time with feed(), so input_finished is only set by finish(),
+	while for the other constructors the input is all there from the beginning.
+	Its output is written to the stream_buffer, which is handed to the sink whenever it is full.
+	*/
+	bool input_finished = true;
+	lzw_sink sink = nullptr;
+	void *sink_context = nullptr;
+	uchar *stream_buffer = nullptr;
+
+	/*
+	The stripes of compress_parallel are compressed as streams of their own, which are then joined into one stream.
+	after_stripe is set when the stream continues the stripe before it, so it begins without the clear code,
+	and before_stripe when the stripe after it continues the stream, so it ends with a clear code in place of the end_of_information code.
+	stream_bits is the number of bits in the stream once it is done, as the stripes are joined without padding them to a byte.
+	*/
+	bool after_stripe = false
+		, before_stripe = false;
+	long long stream_bits = 0;
+
+	/*
+	The compressor each worker of the pool compresses its stripes with, kept for the next compress_parallel, so their tables are allocated once per worker
+	and not once per call. stripe_worker_count is the size of the array, which is grown to the size of the pool.
+	*/
+	LZWCompress **stripe_workers = nullptr;
+	int stripe_worker_count = 0;
+
+	/*
+	The side index the points of the clear codes are pushed to as they are written, see set_index, nullptr when there is none.
+	input_base is the number of bytes of the input that came before the buffer we are compressing, as the input can come in more than one buffer.
+	*/
+	MyList<lzw_clear_point> *index = nullptr;
+	long long input_base = 0;
 
 	/*
-	table stores all the dictionary structures that form the basis of LZW compression.
+	table stores all the dictionary structures that form the basis of LZW compression, only the table of the selected engine is allocated.
 	*/
+	int engine;
 	HashTable *table; 
+	CompactTable *compact_table;
+	ChildTable *child_table;
 
 	void write_multibyte_buffer(uint information);
+	void mark_clear(long long output_offset);
+	void begin_dictionary();
+	void table_filled();
+	bool ratio_degraded();
+	template<class Table> inline bool step_width(Table *engine_table, int max_width);
+	template<class Table, int StartWidth, int MaxWidth, bool Lookahead = false> int compress_table(Table *engine_table);
+	template<class Table> int match_length(Table *engine_table, int position, int *codes);
+	template<class Table> int choose_code(Table *engine_table);
+	template<int StartWidth> int compress_gif();
+	int compress_engine();
+	void create_table(int start_width, int engine);
+	void reset_table(int start_width);
+	void reset_runs(int start_width);
+	bool drain_to_sink();
+	int compress_to_sink();
+	static void compress_stripe_task(void *context, int index, int worker);
 public:
 #ifdef FILE_READ_BUILD
-	LZWCompress(std::FILE *, int start_width = DEFAULT_BYTE_LEN);
+	LZWCompress(std::FILE *, int start_width = DEFAULT_BYTE_LEN, int engine = HASH_TABLE_ENGINE, const lzw_allocator *allocator = nullptr);
 #else
-	LZWCompress(uchar *, int buffer_size, int start_width = DEFAULT_BYTE_LEN);
+	LZWCompress(uchar *, int buffer_size, int start_width = DEFAULT_BYTE_LEN, int engine = HASH_TABLE_ENGINE, const lzw_allocator *allocator = nullptr);
 #endif
+	LZWCompress(lzw_sink sink, void *sink_context, int start_width = DEFAULT_BYTE_LEN, int engine = HASH_TABLE_ENGINE, const lzw_allocator *allocator = nullptr);
+	LZWCompress(int start_width, int engine = HASH_TABLE_ENGINE, const lzw_allocator *allocator = nullptr);
 	~LZWCompress();
+	void set_framing(int framing);
+	void set_index(MyList<lzw_clear_point> *index);
+	void set_max_width(int max_width);
+	void set_clear_policy(int clear_policy);
+	void set_lookahead(int codes);
+	void reset(const uchar *input, int input_size, int start_width);
+	int feed(const uchar *input, int input_size);
+	int flush();
+	int finish();
 	int compress();
+	int compress_into(uchar *output, int output_size, int *written);
+	int compress_parallel(ThreadPool *pool, int stripe_count = 0);
 	uchar *acquire_buffer(int *size);
+	static long long compress_bound(long long input_size, int start_width = DEFAULT_BYTE_LEN, int engine = HASH_TABLE_ENGINE, int framing = LZW_FRAMING_NONE,
+		int max_width = 0, int clear_policy = LZW_CLEAR_WHEN_FULL);
 };
 
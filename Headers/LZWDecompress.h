@@ -24,6 +24,14 @@
 
 #pragma once
 #include "LZWBase.h"
+#include "BitStream.h"
+#include "ThreadPool.h"
+
+/*
+decompress_parallel splits the stream into LZW_SEGMENTS_PER_WORKER segments per thread of the pool(at clear codes), more segments than threads
+so the threads that are given the segments that decode faster can take the segments of the others.
+*/
+#define LZW_SEGMENTS_PER_WORKER 4
 
 class
 	/*
@@ -44,37 +52,83 @@ private LZWBase
 private:
 	//char *decompression_read_buffer; //Small 4 byte buffer to convert integer from big-to-little endian
 
-	char *decompression_buffer; //Actual buffer where all the decompressed data will be stored
+	char *decompression_buffer = nullptr; //Actual buffer where all the decompressed data will be stored, allocated from the allocator by decompress()
 	int decompression_buffer_size = BUFFER_SIZE
-		, decompression_buffer_pointer = 0; //The size and pointer for the decompression_buffer
+		, decompression_buffer_pointer = 0; //The size of the decompression_buffer, and the number of bytes decompressed so far
+
+	/*
+	The memory the strings are written to, output_base is where the byte number output_window of the stream goes,
+	and output_end is the number of the first byte that does not fit in it.
+	For decompress() it is the whole decompression_buffer, while for decompress_into() it is the memory given by the user for this call only.
+	*/
+	char *output_base = nullptr;
+	int output_window = 0
+		, output_end = 0;
+
+	/*
+	The code whose string is being written, and how much of it is written already, so we can stop in the middle of a string when the output is full.
+	pending_code is -1 when there is no such string.
+	*/
+	int pending_code = -1
+		, pending_offset = 0;
+	bool finished = false
+		, bad_code = false;
+
+	/*
+	A worker of decompress_parallel stops at the stop_clears-th clear code it reads, that is at the end of its segment, it is 0 for every other decompressor.
+	*/
+	int stop_clears = 0;
+
+	/*
+	The streaming decompressor is given its input a chunk at a time with feed(), so running out of bits only ends the stream
+	once finish_input() has been called, for the other constructors the input is all there from the beginning.
+	*/
+	bool input_finished = true
+		, streaming = false;
 
 	MyList<storage_info> *dictionary;
 
-	unsigned char *compressed_data_buffer;
-	int compressed_data_size = BUFFER_SIZE,
-		compressed_data_pointer = 0;
+	unsigned char *compressed_data_buffer = nullptr;
+	int compressed_data_size = BUFFER_SIZE;
+
+	/*
+	Reader that pulls the variable width codes out of the compressed_data_buffer.
+	*/
+	BitReader reader;
 
-	char bit_pointer = 0
-		, byte_width = 0
+	char byte_width = 0
 		, default_byte_width = 0;
 	bool can_push = false;
 
-	::FILE *file_in;
+	::FILE *file_in = nullptr;
 
-	int last = -1;
+	int last = -1
+		, last_position = 0; //The position in the decompression_buffer where the string of the last code was written
 	char lastchar = 0;
-	char get_first_byte(storage_info *info);
 	int read_next_bits();
-	void read_compressed_stream(uint i_);
-	void add_to_buffer(int code);
+	template<int StartWidth, int MaxWidth> void read_compressed_stream(uint i_);
+	void write_string(storage_info *info, int from, int count, char *destination);
+	bool write_pending();
+	template<int StartWidth, int MaxWidth> int decode_codes();
+	int decode();
+	void create_dictionary();
+	static void decode_segment_task(void *context, int index, int worker);
 public:
 #ifdef FILE_READ_BUILD
-	LZWDecompress(std::FILE *file, int start_width = DEFAULT_BYTE_LEN);
+	LZWDecompress(std::FILE *file, int start_width = DEFAULT_BYTE_LEN, int max_width = MAX_BYTE_LEN, const lzw_allocator *allocator = nullptr);
 #else
-	LZWDecompress(unsigned char * memory, int buffer_size, int start_width = DEFAULT_BYTE_LEN);
+	LZWDecompress(unsigned char * memory, int buffer_size, int start_width = DEFAULT_BYTE_LEN, int max_width = MAX_BYTE_LEN, const lzw_allocator *allocator = nullptr);
 #endif
+	LZWDecompress(int start_width = DEFAULT_BYTE_LEN, int max_width = MAX_BYTE_LEN, const lzw_allocator *allocator = nullptr);
 	~LZWDecompress();
-	void decompress();
+	void set_framing(int framing);
+	void reset(const uchar *input, int input_size, int start_width);
+	void feed(const uchar *input, int input_size);
+	void finish_input();
+	int decompress();
+	int decompress_into(char *output, int output_size, int *written);
+	bool build_index(MyList<lzw_clear_point> *index);
+	int decompress_parallel(ThreadPool *pool, MyList<lzw_clear_point> *index);
 	char *acquire_buffer(int *size);
 };
 
@@ -24,6 +24,7 @@
 
 #include <malloc.h>
 #include <memory.h>
+#include "Allocator.h"
 /*
 The MyList creates an object capable of storing the default_memory_elements number of type T objects.
 So, if you know your objects are of huge size, and you don't need this much of elements to begin with, since the list auto expands as required
@@ -42,13 +43,15 @@ private:
 	T * list_memory;
 	unsigned int pointer = 0
 		, size = 0;
+	const lzw_allocator *allocator;
 public:
 
 	/*
-	Allocates memory to create appropriate structures requires to store all the object that will be pushed.
+	Allocates memory to create appropriate structures requires to store all the object that will be pushed, from the allocator(::malloc if it is nullptr).
 	*/
-	MyList() {
-		list_memory = (T*)::malloc(sizeof(T)*DEFAULT_MEMORY_ELEMENTS);
+	MyList(const lzw_allocator *allocator = nullptr) {
+		this->allocator = allocator;
+		list_memory = (T*)lzw_alloc(allocator, sizeof(T)*DEFAULT_MEMORY_ELEMENTS);
 		size = DEFAULT_MEMORY_ELEMENTS;
 	}
 
@@ -73,10 +76,10 @@ public:
 		void *memory = 0;
 		int copy_size = list_size() * sizeof(T),
 			destination_size = size * sizeof(T);
-		if ((memory = ::realloc(list_memory, destination_size)) == 0) {
-			memory = ::malloc(copy_size);
+		if ((memory = lzw_realloc(allocator, list_memory, copy_size, destination_size)) == 0) {
+			memory = lzw_alloc(allocator, destination_size);
 			::memcpy(memory, list_memory, copy_size);
-			::free(list_memory);
+			lzw_free(allocator, list_memory);
 		}
 		else ::memset(((char*)memory + copy_size), 0, destination_size - copy_size);
 
@@ -97,12 +100,20 @@ public:
 		return this->pointer;
 	}
 
+	/*
+	Drops all the objects after the first new_size objects, the memory is not touched at all so it takes the same time regardless of the size of the list.
+	The dropped objects are only overwritten as the new objects are pushed.
+	*/
+	void truncate(unsigned int new_size) {
+		if (new_size < pointer) pointer = new_size;
+	}
+
 	/*Deletes all the objects in the list and release and then re allocate memory to defaults*/
 	void clear() {
 		if(this->size>(DEFAULT_MEMORY_ELEMENTS<<1))
 		{
 			free_list();
-			list_memory = (T*)::malloc(sizeof(T)*DEFAULT_MEMORY_ELEMENTS);
+			list_memory = (T*)lzw_alloc(allocator, sizeof(T)*DEFAULT_MEMORY_ELEMENTS);
 			size = DEFAULT_MEMORY_ELEMENTS;
 		}
 		else ::memset(list_memory, 0, sizeof(T)*this->size);
@@ -111,6 +122,6 @@ public:
 
 private:
 	void free_list() {
-		::free(list_memory);
+		lzw_free(allocator, list_memory);
 	}
 };
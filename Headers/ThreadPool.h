@@ -0,0 +1,97 @@
+/*
+    GIFLZWLib --
+    This library provides LZW compression and decompression routine for GIF stream compression.
+
+    Author: Arshdeep Singh, copyleft 2017.
+    LZW algorithm was originally created by Abraham Lempel, Jacob Ziv, and Terry Welch.
+
+    Please see "LICENCE" to read the GPL.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/*
+A task of a batch, it is called once for every index from 0 to the number of tasks in the batch, with the context given to ThreadPool::run.
+The worker is the number of the thread that runs it(0 is the thread that called run), so a task can keep per thread state in an array.
+*/
+typedef void(*pool_task)(void *context, int index, int worker);
+
+/*
+Type: Structure
+Explanation: The tasks a worker still has to run, a range of task indices [begin, end).
+The owner takes its tasks one at a time from the beginning, while a thief steals the second half of the range from the end.
+*/
+struct pool_queue {
+	std::mutex lock;
+	int begin = 0
+		, end = 0;
+};
+
+class
+	/*
+	We only need to have __declspec in MSVC++ as in gcc we compile with -fPIC and -shared
+	*/
+#if defined(__GCC__)
+	//We have nothing to do in here but we still have it for completeness.
+#elif defined(_MSC_VER)
+#ifdef EXPORT
+	__declspec(dllexport)
+#else
+	__declspec(dllimport)
+#endif
+#endif
+ThreadPool
+{
+private:
+	/*
+	The thread that calls run() works as worker 0, so there are only thread_count - 1 threads of our own, they are started once and wait for the batches.
+	*/
+	int thread_count;
+	std::thread *threads;
+	pool_queue *queues;
+
+	/*
+	The batch being run, generation is bumped for every batch so the workers know there is a new one, and working counts the workers still in it.
+	*/
+	std::mutex batch_lock
+		, run_lock;
+	std::condition_variable batch_ready
+		, batch_done;
+	pool_task task = nullptr;
+	void *context = nullptr;
+	unsigned int generation = 0;
+	int working = 0;
+	bool stopping = false;
+
+	bool next_task(int worker, int *index);
+	void work(int worker);
+	void worker_loop(int worker);
+public:
+	ThreadPool(int thread_count = 0);
+	~ThreadPool();
+
+	/*
+	Returns the number of threads that run the tasks, including the thread that calls run().
+	*/
+	int size() {
+		return thread_count;
+	}
+	void run(int task_count, pool_task task, void *context);
+};
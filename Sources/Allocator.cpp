@@ -0,0 +1,316 @@
+/*
+    GIFLZWLib --
+    This library provides LZW compression and decompression routine for GIF stream compression.
+
+    Author: Arshdeep Singh, copyleft 2017.
+    LZW algorithm was originally created by Abraham Lempel, Jacob Ziv, and Terry Welch.
+
+    Please see "LICENCE" to read the GPL.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#include "../Headers/Allocator.h"
+
+/*
+The chunk header is rounded up so the memory after it begins at a multiple of ARENA_ALIGNMENT.
+*/
+#define ARENA_HEADER_SIZE ((sizeof(arena_chunk) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+/*
+Rounds a size up to a multiple of ARENA_ALIGNMENT.
+*/
+static inline size_t arena_round(size_t size)
+{
+	return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+/*
+Constructor: the arena takes no memory until the first allocation, and then takes it from ::malloc chunk_size bytes at a time.
+*/
+ArenaAllocator::ArenaAllocator(size_t chunk_size)
+{
+	this->chunk_size = chunk_size;
+	functions.allocate = arena_allocate;
+	functions.reallocate = arena_reallocate;
+	functions.release = arena_release;
+	functions.context = this;
+}
+
+/*
+Frees all of the chunks, and so everything that was ever allocated from the arena.
+*/
+ArenaAllocator::~ArenaAllocator()
+{
+	while (chunks != nullptr) {
+		arena_chunk *next = chunks->next;
+		::free(chunks);
+		chunks = next;
+	}
+}
+
+/*
+Bumps "size" bytes out of the newest chunk, and begins a new chunk when it does not have the room, the lock must be held.
+-----------------
+The room left in the older chunks is never used again, which is the price of never having to search for room.
+*/
+void *ArenaAllocator::bump(size_t size)
+{
+	size = arena_round(size);
+	if (chunks == nullptr || chunks->size - chunks->used < size) {
+		size_t capacity = size > chunk_size ? size : chunk_size;
+		arena_chunk *chunk = (arena_chunk*)::malloc(ARENA_HEADER_SIZE + capacity);
+		if (chunk == nullptr)
+			return nullptr;
+		chunk->next = chunks;
+		chunk->size = capacity;
+		chunk->used = 0;
+		chunks = chunk;
+	}
+
+	last = (char*)chunks + ARENA_HEADER_SIZE + chunks->used;
+	last_size = size;
+	chunks->used += size;
+	return last;
+}
+
+/*
+lzw_allocate of the arena.
+*/
+void *ArenaAllocator::arena_allocate(void *context, size_t size, bool zeroed)
+{
+	ArenaAllocator *arena = (ArenaAllocator*)context;
+	void *memory;
+	{
+		std::lock_guard<std::mutex> guard(arena->lock);
+		memory = arena->bump(size);
+	}
+	if (memory != nullptr && zeroed)
+		::memset(memory, 0, size);
+	return memory;
+}
+
+/*
+lzw_reallocate of the arena, the newest allocation grows where it is as long as its chunk has the room, as the output buffers that grow
+are most of the time the newest allocation, else the memory is copied to a new allocation and the old one is just left behind.
+*/
+void *ArenaAllocator::arena_reallocate(void *context, void *memory, size_t size, size_t new_size)
+{
+	ArenaAllocator *arena = (ArenaAllocator*)context;
+	void *moved;
+	{
+		std::lock_guard<std::mutex> guard(arena->lock);
+		if (memory != nullptr && memory == arena->last) {
+			size_t offset = (char*)memory - ((char*)arena->chunks + ARENA_HEADER_SIZE);
+			if (arena_round(new_size) <= arena->chunks->size - offset) {
+				arena->chunks->used = offset + arena_round(new_size);
+				arena->last_size = arena_round(new_size);
+				return memory;
+			}
+		}
+		moved = arena->bump(new_size);
+	}
+	if (moved != nullptr && memory != nullptr)
+		::memcpy(moved, memory, size);
+	return moved;
+}
+
+/*
+lzw_release of the arena, the memory is only given back when the arena is freed or release_all is called,
+except for the newest allocation that is simply bumped back.
+*/
+void ArenaAllocator::arena_release(void *context, void *memory)
+{
+	ArenaAllocator *arena = (ArenaAllocator*)context;
+	std::lock_guard<std::mutex> guard(arena->lock);
+	if (memory != nullptr && memory == arena->last) {
+		arena->chunks->used -= arena->last_size;
+		arena->last = nullptr;
+		arena->last_size = 0;
+	}
+}
+
+/*
+Releases everything that was allocated from the arena at once, such as all the memory of a request, none of it may be used afterwards.
+One chunk of chunk_size is kept, so an arena that is used for one request after another does not go back to ::malloc for every request.
+*/
+void ArenaAllocator::release_all()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	arena_chunk *kept = nullptr;
+	while (chunks != nullptr) {
+		arena_chunk *next = chunks->next;
+		if (kept == nullptr && chunks->size == chunk_size) {
+			kept = chunks;
+			kept->next = nullptr;
+			kept->used = 0;
+		}
+		else
+			::free(chunks);
+		chunks = next;
+	}
+	chunks = kept;
+	last = nullptr;
+	last_size = 0;
+}
+
+/*
+Returns the number of bytes handed out by the arena since it was created or last released.
+*/
+size_t ArenaAllocator::used()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	size_t total = 0;
+	for (arena_chunk *chunk = chunks; chunk != nullptr; chunk = chunk->next)
+		total += chunk->used;
+	return total;
+}
+
+/*
+Every block of the PoolAllocator begins with a header that records its size class, the memory handed out follows it.
+The header is 16 bytes so the memory keeps the alignment of ::malloc, and blocks too large for the pool have the class POOL_NO_CLASS.
+*/
+#define POOL_HEADER_SIZE 16
+#define POOL_NO_CLASS -1
+
+/*
+Type: Structure
+Explanation: The blocks a thread keeps for later, one stack of at most POOL_CACHED_BLOCKS blocks per size class.
+The blocks are freed when the thread ends.
+*/
+struct pool_cache {
+	void *blocks[POOL_MAX_CLASS + 1][POOL_CACHED_BLOCKS];
+	int counts[POOL_MAX_CLASS + 1];
+
+	pool_cache() {
+		::memset(counts, 0, sizeof(counts));
+	}
+
+	~pool_cache() {
+		free_blocks();
+	}
+
+	void free_blocks() {
+		for (int size_class = POOL_MIN_CLASS; size_class <= POOL_MAX_CLASS; size_class++) {
+			while (counts[size_class] > 0)
+				::free(blocks[size_class][--counts[size_class]]);
+		}
+	}
+};
+
+/*
+Each thread has a cache of its own, so the threads never wait on each other or on the global allocator for the blocks they reuse.
+A block released on another thread than the one that allocated it simply joins the cache of the thread that released it.
+*/
+static thread_local pool_cache cache;
+
+/*
+Returns the size class of a block that has room for "size" bytes and the header, or POOL_NO_CLASS if it is too large for the pool.
+*/
+static int pool_size_class(size_t size)
+{
+	size_t total = size + POOL_HEADER_SIZE;
+	int size_class = POOL_MIN_CLASS;
+	while (((size_t)1 << size_class) < total) {
+		if (++size_class > POOL_MAX_CLASS)
+			return POOL_NO_CLASS;
+	}
+	return size_class;
+}
+
+/*
+Constructor: the PoolAllocator has no state of its own, the blocks are kept by the threads, so any number of them can be created.
+*/
+PoolAllocator::PoolAllocator()
+{
+	functions.allocate = pool_allocate;
+	functions.reallocate = pool_reallocate;
+	functions.release = pool_release;
+	functions.context = this;
+}
+
+/*
+lzw_allocate of the pool, a block of the size class is taken from the thread's cache, or from ::malloc when the cache has none.
+*/
+void *PoolAllocator::pool_allocate(void *, size_t size, bool zeroed)
+{
+	int size_class = pool_size_class(size);
+	char *block;
+	if (size_class == POOL_NO_CLASS)
+		block = (char*)(zeroed ? ::calloc(size + POOL_HEADER_SIZE, 1) : ::malloc(size + POOL_HEADER_SIZE));
+	else if (cache.counts[size_class] > 0) {
+		block = (char*)cache.blocks[size_class][--cache.counts[size_class]];
+		if (zeroed)
+			::memset(block + POOL_HEADER_SIZE, 0, size);
+	}
+	else
+		block = (char*)(zeroed ? ::calloc((size_t)1 << size_class, 1) : ::malloc((size_t)1 << size_class));
+
+	if (block == nullptr)
+		return nullptr;
+	*(int*)block = size_class;
+	return block + POOL_HEADER_SIZE;
+}
+
+/*
+lzw_reallocate of the pool, the block is kept when its size class has the room already, else the memory moves to a block of a larger class.
+The blocks too large for the pool are grown with ::realloc.
+*/
+void *PoolAllocator::pool_reallocate(void *context, void *memory, size_t size, size_t new_size)
+{
+	if (memory == nullptr)
+		return pool_allocate(context, new_size, false);
+
+	char *block = (char*)memory - POOL_HEADER_SIZE;
+	int size_class = *(int*)block;
+	if (size_class == POOL_NO_CLASS) {
+		block = (char*)::realloc(block, new_size + POOL_HEADER_SIZE);
+		return block != nullptr ? block + POOL_HEADER_SIZE : nullptr;
+	}
+	if (new_size + POOL_HEADER_SIZE <= ((size_t)1 << size_class))
+		return memory;
+
+	void *moved = pool_allocate(context, new_size, false);
+	if (moved == nullptr)
+		return nullptr;
+	::memcpy(moved, memory, size);
+	pool_release(context, memory);
+	return moved;
+}
+
+/*
+lzw_release of the pool, the block goes back to the thread's cache, or to ::free when the cache of its size class is full.
+*/
+void PoolAllocator::pool_release(void *, void *memory)
+{
+	if (memory == nullptr)
+		return;
+
+	char *block = (char*)memory - POOL_HEADER_SIZE;
+	int size_class = *(int*)block;
+	if (size_class != POOL_NO_CLASS && cache.counts[size_class] < POOL_CACHED_BLOCKS)
+		cache.blocks[size_class][cache.counts[size_class]++] = block;
+	else
+		::free(block);
+}
+
+/*
+Frees the blocks the calling thread keeps, the threads free theirs when they end anyways, so this is only needed to give the memory back sooner.
+*/
+void PoolAllocator::trim()
+{
+	cache.free_blocks();
+}
@@ -0,0 +1,86 @@
+/*
+    GIFLZWLib --
+    This library provides LZW compression and decompression routine for GIF stream compression.
+
+    Author: Arshdeep Singh, copyleft 2017.
+    LZW algorithm was originally created by Abraham Lempel, Jacob Ziv, and Terry Welch.
+    
+    Please see "LICENCE" to read the GPL.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#include "../Headers/LZWBase.h"
+#include <cstdlib>
+
+/*
+Instantiates the ChildTable for the GIF code space(GIF_MAX_BYTE_LEN bits) and characters of start_width bits, its memory comes from the allocator.
+*/
+ChildTable::ChildTable(int start_width, const lzw_allocator *allocator)
+{
+	this->allocator = allocator;
+	capacity_bits = start_width;
+	children = (ushort*)lzw_alloc(allocator, sizeof(ushort) << (GIF_MAX_BYTE_LEN + start_width), true);
+	slots = (uint*)lzw_alloc(allocator, sizeof(uint) << GIF_MAX_BYTE_LEN);
+
+	base_elements =
+		total_elements = 0;
+	reset(start_width);
+}
+
+/*
+Frees the memory used by the table.
+*/
+ChildTable::~ChildTable()
+{
+	lzw_free(allocator, children);
+	lzw_free(allocator, slots);
+}
+
+/*
+Purges the table, by zeroing only the children of the codes that were added, see the explanation of the ChildTable.
+*/
+void ChildTable::clear()
+{
+	for (uint code = base_elements; code < total_elements; code++)
+		children[slots[code]] = 0;
+	total_elements = base_elements;
+}
+
+/*
+Purges the table and makes it ready for characters of start_width bits, for a stream with a different minimum code size.
+-----------------
+The children of a narrower start_width are just the beginning of the array we have, so only a start_width wider than any before it allocates new children.
+The children of the codes we have are zeroed at the slots they were stored at for the old start_width, so the table is all zeroes for the new one.
+*/
+void ChildTable::reset(int start_width)
+{
+	clear();
+	if ((uint)start_width > capacity_bits) {
+		lzw_free(allocator, children);
+		capacity_bits = start_width;
+		children = (ushort*)lzw_alloc(allocator, sizeof(ushort) << (GIF_MAX_BYTE_LEN + start_width), true);
+	}
+
+	char_bits = start_width;
+	char_mask = (1 << start_width) - 1;
+
+	/*
+	The root codes, the clear code and the end_of_information code are implicit, so the first code we add is (1<<start_width)+2.
+	*/
+	base_elements =
+		total_elements = (1 << start_width) + 2;
+}
@@ -0,0 +1,88 @@
+/*
+    GIFLZWLib --
+    This library provides LZW compression and decompression routine for GIF stream compression.
+
+    Author: Arshdeep Singh, copyleft 2017.
+    LZW algorithm was originally created by Abraham Lempel, Jacob Ziv, and Terry Welch.
+    
+    Please see "LICENCE" to read the GPL.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+
+#include "../Headers/CompactTable.h"
+#include <cstring>
+#include <cstdlib>
+
+/*
+Instantiates the CompactTable for codes that start at start_width bits and go up to max_width bits, its memory comes from the allocator.
+-----------------
+The groups must start at a cache line boundary, and since ::malloc(and the other allocators) only promise 16 bytes we allocate an extra line and align the pointer ourselves.
+The memory is zeroed, so every group starts in the COMPACT_EPOCH_NONE epoch and is empty.
+*/
+CompactTable::CompactTable(int start_width, int max_width, const lzw_allocator *allocator)
+{
+	uint group_count = 2
+		, group_bits = 1;
+	while (group_count * COMPACT_GROUP_SIZE < (uint)(COMPACT_SLOT_FACTOR << max_width)) {
+		group_count <<= 1;
+		++group_bits;
+	}
+
+	this->allocator = allocator;
+	group_memory = lzw_alloc(allocator, group_count * sizeof(compact_group) + 64, true);
+	groups = (compact_group*)(((size_t)group_memory + 63) & ~(size_t)63);
+	group_mask = group_count - 1;
+	group_shift = 32 - group_bits;
+	epoch = COMPACT_EPOCH_NONE;
+
+	reset(start_width);
+}
+
+/*
+Frees the memory used by the table.
+*/
+CompactTable::~CompactTable()
+{
+	lzw_free(allocator, group_memory);
+}
+
+/*
+Purges the table by moving it to the next epoch, so all the groups written before are empty from now on(see group_tags),
+and a group is only wiped when it is next added to. Only the tags decide if a slot is used, so the keys and the codes are never zeroed,
+and the epochs of all the groups are only zeroed once every COMPACT_EPOCH_LIMIT clears when the epoch wraps around.
+*/
+void CompactTable::clear()
+{
+	if (++epoch > COMPACT_EPOCH_LIMIT) {
+		for (uint i = 0; i <= group_mask; i++)
+			groups[i].epoch = COMPACT_EPOCH_NONE;
+		epoch = COMPACT_EPOCH_NONE + 1;
+	}
+	total_elements = base_elements;
+}
+
+/*
+Purges the table and makes it ready for characters of start_width bits, the keys have room for 8 bit characters so the groups are kept as they are.
+*/
+void CompactTable::reset(int start_width)
+{
+	/*
+	The root codes, the clear code and the end_of_information code are implicit, so the first code we add is (1<<start_width)+2.
+	*/
+	base_elements = (1 << start_width) + 2;
+	clear();
+}
@@ -0,0 +1,803 @@
+/*
+    GIFLZWLib --
+    This library provides LZW compression and decompression routine for GIF stream compression.
+
+    Author: Arshdeep Singh, copyleft 2017.
+    LZW algorithm was originally created by Abraham Lempel, Jacob Ziv, and Terry Welch.
+
+    Please see "LICENCE" to read the GPL.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "../Headers/GIFContainer.h"
+#include <cstring>
+#include <cstdlib>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/*
+The 4 passes of an interlaced frame are every 8th row from row 0, every 8th row from row 4, every 4th row from row 2 and every 2nd row from row 1.
+*/
+static const int pass_start[4] = { 0, 4, 2, 1 }
+	, pass_step[4] = { 8, 8, 4, 2 };
+
+/*
+Returns the number of colors of the color table that holds "colors" colors, GIF color tables always have a power of two colors, from 2 to 256.
+*/
+static int table_colors(int colors)
+{
+	int table = 2;
+	while (table < colors && table < 256) table <<= 1;
+	return table;
+}
+
+/*
+Returns the number of bits a color index of a color table with table_colors colors takes, the size field of the color table is one less than that.
+*/
+static int table_bits(int table_colors)
+{
+	int bits = 1;
+	while ((1 << bits) < table_colors) ++bits;
+	return bits;
+}
+
+/*
+Constructor: maps the GIF file into memory, it is read by the operating system only as the frames are indexed and decoded.
+The index of the frames and the decompressors come from the allocator.
+*/
+GIFReader::GIFReader(const char *path, const lzw_allocator *allocator)
+{
+	this->allocator = allocator;
+	frames = new MyList<gif_frame>(allocator);
+
+#if defined(_WIN32)
+	HANDLE file = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return;
+
+	LARGE_INTEGER file_size;
+	if (::GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+		mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr) {
+			gif = (const uchar*)::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			gif_size = file_size.QuadPart;
+		}
+	}
+	::CloseHandle(file);
+#else
+	int file = ::open(path, O_RDONLY);
+	if (file < 0) return;
+
+	struct stat status;
+	if (::fstat(file, &status) == 0 && status.st_size > 0) {
+		void *memory = ::mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (memory != MAP_FAILED) {
+			gif = (const uchar*)memory;
+			gif_size = status.st_size;
+		}
+	}
+	::close(file);
+#endif
+
+	if (gif == nullptr) {
+		gif_size = 0;
+		return;
+	}
+	mapped = true;
+	parse_header();
+}
+
+/*
+Constructor: reads the GIF from memory given by the user, which must stay valid as long as the reader is used.
+*/
+GIFReader::GIFReader(const uchar *memory, long long memory_size, const lzw_allocator *allocator)
+{
+	this->allocator = allocator;
+	frames = new MyList<gif_frame>(allocator);
+
+	gif = memory;
+	gif_size = memory != nullptr ? memory_size : 0;
+	parse_header();
+}
+
+/*
+Unmaps the GIF if we mapped it.
+*/
+GIFReader::~GIFReader()
+{
+	if (mapped) {
+#if defined(_WIN32)
+		::UnmapViewOfFile(gif);
+		::CloseHandle(mapping);
+#else
+		::munmap((void*)gif, gif_size);
+#endif
+	}
+	delete frames;
+}
+
+/*
+Reads the header, the logical screen descriptor and the global color table, the frames are indexed later as they are asked for.
+*/
+void GIFReader::parse_header()
+{
+	if (gif_size < 13
+		|| ::memcmp(gif, "GIF", 3) != 0
+		|| (::memcmp(gif + 3, "87a", 3) != 0 && ::memcmp(gif + 3, "89a", 3) != 0))
+		return;
+
+	screen_width = gif[6] | (gif[7] << 8);
+	screen_height = gif[8] | (gif[9] << 8);
+
+	uchar packed = gif[10];
+	scan_offset = 13;
+	if (packed & 0x80) {
+		global_colors = 1 << ((packed & 7) + 1);
+		if (scan_offset + 3 * global_colors > gif_size)
+			return;
+		global_palette = gif + scan_offset;
+		scan_offset += 3 * global_colors;
+	}
+	valid = true;
+}
+
+/*
+Returns the offset just after the terminating sub-block of the sub-blocks that begin at offset, or -1 if the GIF ends before it.
+Only the length bytes are read, the data of the sub-blocks is never touched.
+*/
+long long GIFReader::skip_sub_blocks(long long offset)
+{
+	while (offset < gif_size) {
+		int length = gif[offset++];
+		if (length == 0)
+			return offset;
+		offset += length;
+	}
+	return -1;
+}
+
+/*
+Indexes the blocks up to and including the next frame, returns false if there are no more frames.
+The index only records where the frame's palette and LZW stream are in the GIF, so indexing a frame costs a few reads per sub-block.
+A GIF that is cut short keeps the frames that are whole, the broken frame and anything after it are ignored.
+*/
+bool GIFReader::index_next()
+{
+	while (valid && !scan_finished && scan_offset < gif_size) {
+		uchar block = gif[scan_offset];
+
+		if (block == GIF_IMAGE_SEPARATOR) {
+			if (scan_offset + 10 > gif_size) break;
+			const uchar *descriptor = gif + scan_offset + 1;
+			long long offset = scan_offset + 10;
+
+			gif_frame frame;
+			frame.left = descriptor[0] | (descriptor[1] << 8);
+			frame.top = descriptor[2] | (descriptor[3] << 8);
+			frame.width = descriptor[4] | (descriptor[5] << 8);
+			frame.height = descriptor[6] | (descriptor[7] << 8);
+			frame.interlaced = (descriptor[8] & 0x40) != 0;
+			frame.local_palette = (descriptor[8] & 0x80) != 0;
+
+			if (frame.local_palette) {
+				frame.palette_colors = 1 << ((descriptor[8] & 7) + 1);
+				if (offset + 3 * frame.palette_colors > gif_size) break;
+				frame.palette = gif + offset;
+				offset += 3 * frame.palette_colors;
+			}
+			else {
+				frame.palette_colors = global_colors;
+				frame.palette = global_palette;
+			}
+
+			if (offset >= gif_size) break;
+			frame.min_code_size = gif[offset++];
+
+			long long end = skip_sub_blocks(offset);
+			if (end < 0) break;
+			frame.data = gif + offset;
+			frame.data_size = (int)(end - offset);
+
+			//The graphic control extension only applies to the frame right after it.
+			frame.delay = pending_delay;
+			frame.disposal = pending_disposal;
+			frame.transparent_index = pending_transparent;
+			pending_delay =
+				pending_disposal = 0;
+			pending_transparent = -1;
+
+			frames->push(frame);
+			scan_offset = end;
+			return true;
+		}
+		else if (block == GIF_EXTENSION_INTRODUCER) {
+			if (scan_offset + 2 > gif_size) break;
+			uchar label = gif[scan_offset + 1];
+			long long offset = scan_offset + 2;
+
+			if (label == GIF_GRAPHIC_CONTROL_LABEL && offset + 5 <= gif_size && gif[offset] >= 4) {
+				const uchar *control = gif + offset + 1;
+				pending_disposal = (control[0] >> 2) & 7;
+				pending_delay = control[1] | (control[2] << 8);
+				pending_transparent = (control[0] & 1) ? control[3] : -1;
+			}
+			else if (label == GIF_APPLICATION_LABEL && offset + 16 <= gif_size && gif[offset] == 11
+				&& ::memcmp(gif + offset + 1, "NETSCAPE2.0", 11) == 0 && gif[offset + 12] >= 3 && gif[offset + 13] == 1) {
+				loop = gif[offset + 14] | (gif[offset + 15] << 8);
+			}
+
+			long long end = skip_sub_blocks(offset);
+			if (end < 0) break;
+			scan_offset = end;
+		}
+		else break; // The trailer, or something that is not a GIF block, either way there are no more frames.
+	}
+	scan_finished = true;
+	return false;
+}
+
+/*
+Returns the global color table(3 bytes per color) and its number of colors, or nullptr if the GIF has none.
+*/
+const uchar *GIFReader::palette(int *colors)
+{
+	*colors = global_colors;
+	return global_palette;
+}
+
+/*
+Returns the loop count of the NETSCAPE2.0 application extension(0 loops forever), or -1 if the GIF does not have one.
+The extension comes before the first frame, so we index up to the first frame to find it.
+*/
+int GIFReader::loop_count()
+{
+	if (frames->list_size() == 0)
+		index_next();
+	return loop;
+}
+
+/*
+Returns the number of frames in the GIF, this indexes all of the frames.
+*/
+int GIFReader::frame_count()
+{
+	while (index_next());
+	return (int)frames->list_size();
+}
+
+/*
+Copies the description of the frame number "index" to "description", indexing the frames up to it if they are not indexed yet.
+Returns false if the GIF has no such frame.
+*/
+bool GIFReader::frame(int index, gif_frame *description)
+{
+	if (index < 0) return false;
+	while ((int)frames->list_size() <= index && index_next());
+	if ((int)frames->list_size() <= index) return false;
+
+	*description = *(*frames)[index];
+	return true;
+}
+
+/*
+Decodes the frame number "index" into "pixels", which must have room for the width*height color indices of the frame.
+Returns false if there is no such frame, or its LZW stream is broken or ends before all of the pixels, the pixels that were decoded are kept.
+*/
+bool GIFReader::decode_frame(int index, uchar *pixels, int pixels_size)
+{
+	LZWDecompress decompress(GIF_MAX_CODE_SIZE, GIF_MAX_BYTE_LEN, allocator);
+	decompress.set_framing(LZW_FRAMING_SUB_BLOCKS);
+	return decode_frame_with(&decompress, index, pixels, pixels_size);
+}
+
+/*
+Decodes the frame number "index" with the given decompressor, which is reset to the frame's stream so it can be used for any number of frames.
+-----------------
+The decompressor reads the sub-blocks straight out of the GIF and writes the rows straight into "pixels",
+an interlaced frame is decoded a row at a time with each row written to where it belongs, so it is never copied to be put in order.
+*/
+bool GIFReader::decode_frame_with(LZWDecompress *decompress, int index, uchar *pixels, int pixels_size)
+{
+	gif_frame frame;
+	if (!this->frame(index, &frame)
+		|| frame.min_code_size < GIF_MIN_CODE_SIZE || frame.min_code_size > GIF_MAX_CODE_SIZE
+		|| (long long)frame.width * frame.height > pixels_size)
+		return false;
+	if (frame.width == 0 || frame.height == 0)
+		return true;
+
+	decompress->reset(frame.data, frame.data_size, frame.min_code_size);
+	decompress->finish_input();
+
+	int written = 0;
+	if (!frame.interlaced) {
+		int pixel_count = frame.width * frame.height;
+		decompress->decompress_into((char*)pixels, pixel_count, &written);
+		return written == pixel_count;
+	}
+
+	for (int pass = 0; pass < 4; pass++) {
+		for (int row = pass_start[pass]; row < frame.height; row += pass_step[pass]) {
+			decompress->decompress_into((char*)pixels + (long long)row * frame.width, frame.width, &written);
+			if (written != frame.width)
+				return false;
+		}
+	}
+	return true;
+}
+
+/*
+Type: Structure
+Explanation: What the tasks of GIFReader::decode_frames share, the reader and where each frame goes.
+workers:	the decompressor each worker keeps for all the frames it decodes, it is reset for each frame.
+*/
+struct decode_batch {
+	GIFReader *reader;
+	uchar **pixels;
+	const int *pixels_sizes;
+	bool *decoded;
+	LZWDecompress **workers;
+};
+
+/*
+A task of GIFReader::decode_frames, decodes a frame with the worker's decompressor.
+*/
+void GIFReader::decode_frame_task(void *context, int index, int worker)
+{
+	decode_batch *batch = (decode_batch*)context;
+	LZWDecompress *decompress = batch->workers[worker];
+	if (decompress == nullptr) {
+		decompress =
+			batch->workers[worker] = new LZWDecompress(GIF_MAX_CODE_SIZE, GIF_MAX_BYTE_LEN, batch->reader->allocator);
+		decompress->set_framing(LZW_FRAMING_SUB_BLOCKS);
+	}
+	batch->decoded[index] = batch->reader->decode_frame_with(decompress, index, batch->pixels[index], batch->pixels_sizes[index]);
+}
+
+/*
+Decodes all of the frames of the GIF at once on the threads of the pool, frame i is decoded into pixels[i] which has room for pixels_sizes[i] bytes.
+-----------------
+The frames are independent LZW streams, so each one is decoded by a task of its own, with the decompressor of the worker that runs it,
+which is reset for each frame so the dictionary is allocated once per worker and not once per frame.
+We index all of the frames first, with a single scan of the GIF, after that the reader is only read from so the tasks can share it.
+Each frame is written to its own pixels, so the output is in order no matter which thread decodes which frame.
+If "decoded" is not nullptr, decoded[i] is set to the result of decode_frame for frame i. Returns true if all of the frames were decoded.
+*/
+bool GIFReader::decode_frames(ThreadPool *pool, uchar **pixels, const int *pixels_sizes, bool *decoded)
+{
+	int count = frame_count();
+	bool *results = decoded != nullptr ? decoded : new bool[count > 0 ? count : 1];
+
+	LZWDecompress **workers = new LZWDecompress*[pool->size()];
+	for (int worker = 0; worker < pool->size(); worker++)
+		workers[worker] = nullptr;
+
+	decode_batch batch = { this, pixels, pixels_sizes, results, workers };
+	pool->run(count, decode_frame_task, &batch);
+
+	for (int worker = 0; worker < pool->size(); worker++)
+		delete workers[worker];
+	delete[] workers;
+
+	bool all = true;
+	for (int frame = 0; frame < count; frame++)
+		all = all && results[frame];
+	if (decoded == nullptr)
+		delete[] results;
+	return all;
+}
+
+/*
+Constructor: begins the GIF with the header, the logical screen descriptor, the global color table(if palette is not nullptr)
+and the NETSCAPE2.0 application extension if loop_count is not -1(0 loops forever).
+The GIF and the compressors come from the allocator.
+*/
+GIFWriter::GIFWriter(int width, int height, const uchar *palette, int colors, int loop_count, const lzw_allocator *allocator)
+{
+	this->allocator = allocator;
+	screen_width = width;
+	screen_height = height;
+	/*
+	A color table has at most 256 colors, the colors of the palette after them are never written.
+	*/
+	global_colors = palette != nullptr ? (colors > 256 ? 256 : colors) : 0;
+
+	reserve(BUFFER_SIZE);
+	::memcpy(buffer, "GIF89a", 6);
+	pointer = 6;
+
+	put_short(width);
+	put_short(height);
+	if (global_colors > 0) {
+		int table = table_colors(global_colors);
+		put_byte((uchar)(0x80 | 0x70 | (table_bits(table) - 1)));
+		put_byte(0); // background color index
+		put_byte(0); // pixel aspect ratio
+		put_palette(palette, global_colors, table);
+	}
+	else {
+		put_byte(0x70);
+		put_byte(0);
+		put_byte(0);
+	}
+
+	if (loop_count >= 0) {
+		put_byte(GIF_EXTENSION_INTRODUCER);
+		put_byte(GIF_APPLICATION_LABEL);
+		put_byte(11);
+		reserve(11);
+		::memcpy(buffer + pointer, "NETSCAPE2.0", 11);
+		pointer += 11;
+		put_byte(3);
+		put_byte(1);
+		put_short(loop_count);
+		put_byte(0);
+	}
+}
+
+/*
+Deletes the compressors of add_frame and add_frames, the GIF itself is not freed as it is handed to the user by acquire_buffer.
+*/
+GIFWriter::~GIFWriter()
+{
+	delete compress;
+	lzw_free(allocator, rows.memory);
+	for (int worker = 0; worker < worker_count; worker++) {
+		delete workers[worker];
+		lzw_free(allocator, worker_rows[worker].memory);
+	}
+	delete[] workers;
+	delete[] worker_rows;
+}
+
+/*
+Makes sure there is space for at least "bytes" more bytes in the buffer, it grows the same way as BitWriter::reserve.
+*/
+void GIFWriter::reserve(int bytes)
+{
+	int new_size = size > 0 ? size : 4;
+	while (new_size < pointer + bytes)
+		new_size <<= (new_size < (1 << 18)) ? 2 : 1;
+	if (new_size == size) return;
+
+	void *memory = lzw_realloc(allocator, buffer, pointer, new_size);
+	if (memory == nullptr) {
+		memory = lzw_alloc(allocator, new_size);
+		::memcpy(memory, buffer, pointer);
+		lzw_free(allocator, buffer);
+	}
+	buffer = (uchar*)memory;
+	size = new_size;
+}
+
+void GIFWriter::put_byte(uchar information)
+{
+	if (pointer + 1 > size) reserve(1);
+	buffer[pointer++] = information;
+}
+
+/*
+GIF stores its 16 bit values least significant byte first.
+*/
+void GIFWriter::put_short(int information)
+{
+	put_byte((uchar)information);
+	put_byte((uchar)(information >> 8));
+}
+
+/*
+Writes a color table of table_colors colors, the colors after the ones in the palette are written as black.
+*/
+void GIFWriter::put_palette(const uchar *palette, int colors, int table_colors)
+{
+	reserve(3 * table_colors);
+	::memcpy(buffer + pointer, palette, 3 * colors);
+	::memset(buffer + pointer + 3 * colors, 0, 3 * (table_colors - colors));
+	pointer += 3 * table_colors;
+}
+
+/*
+Returns the minimum code size of the frame, that is the bits a color index of its palette takes(but never less than GIF_MIN_CODE_SIZE).
+*/
+int GIFWriter::frame_code_size(const gif_frame *frame)
+{
+	bool local = frame->local_palette && frame->palette != nullptr && frame->palette_colors > 0;
+	int colors = local ? frame->palette_colors : global_colors
+		, bits = table_bits(table_colors(colors > 0 ? colors : 256));
+	return bits > GIF_MIN_CODE_SIZE ? bits : GIF_MIN_CODE_SIZE;
+}
+
+/*
+Writes the graphic control extension(if the frame needs one), the image descriptor, the local color table and the minimum code size of the frame to "out",
+which must have room for GIF_FRAME_HEADER_SIZE bytes. Returns the number of bytes written, and the minimum code size in min_code_size.
+*/
+int GIFWriter::put_frame_header(uchar *out, const gif_frame *frame, int *min_code_size)
+{
+	bool local = frame->local_palette && frame->palette != nullptr && frame->palette_colors > 0;
+	int colors = local ? frame->palette_colors : global_colors
+		, table = table_colors(colors > 0 ? colors : 256)
+		, written = 0;
+	*min_code_size = frame_code_size(frame);
+
+	if (frame->delay != 0 || frame->disposal != 0 || frame->transparent_index >= 0) {
+		out[written++] = GIF_EXTENSION_INTRODUCER;
+		out[written++] = GIF_GRAPHIC_CONTROL_LABEL;
+		out[written++] = 4;
+		out[written++] = (uchar)(((frame->disposal & 7) << 2) | (frame->transparent_index >= 0 ? 1 : 0));
+		out[written++] = (uchar)frame->delay;
+		out[written++] = (uchar)(frame->delay >> 8);
+		out[written++] = (uchar)(frame->transparent_index >= 0 ? frame->transparent_index : 0);
+		out[written++] = 0;
+	}
+
+	const int descriptor[4] = { frame->left, frame->top, frame->width, frame->height };
+	out[written++] = GIF_IMAGE_SEPARATOR;
+	for (int i = 0; i < 4; i++) {
+		out[written++] = (uchar)descriptor[i];
+		out[written++] = (uchar)(descriptor[i] >> 8);
+	}
+
+	uchar interlace = frame->interlaced ? 0x40 : 0;
+	if (local) {
+		if (colors > table) colors = table;
+		out[written++] = (uchar)(0x80 | interlace | (table_bits(table) - 1));
+		::memcpy(out + written, frame->palette, 3 * colors);
+		::memset(out + written + 3 * colors, 0, 3 * (table - colors));
+		written += 3 * table;
+	}
+	else out[written++] = interlace;
+
+	out[written++] = (uchar)*min_code_size;
+	return written;
+}
+
+/*
+Returns the pixels of the frame in the order they are compressed in, that is "pixels" itself unless the frame is interlaced,
+then its rows are copied in the order of the 4 passes(see GIFReader::decode_frame_with) to the memory of "rows", which is grown as required and kept for the next frames.
+Returns nullptr if the memory could not be allocated.
+*/
+const uchar *GIFWriter::order_rows(gif_rows *rows, const uchar *pixels, const gif_frame *frame)
+{
+	int pixel_count = frame->width * frame->height;
+	if (!frame->interlaced || pixel_count == 0)
+		return pixels;
+
+	if (rows->size < pixel_count) {
+		lzw_free(allocator, rows->memory);
+		rows->memory = (uchar*)lzw_alloc(allocator, pixel_count);
+		rows->size = rows->memory != nullptr ? pixel_count : 0;
+		if (rows->memory == nullptr)
+			return nullptr;
+	}
+
+	uchar *out = rows->memory;
+	for (int pass = 0; pass < 4; pass++) {
+		for (int row = pass_start[pass]; row < frame->height; row += pass_step[pass]) {
+			::memcpy(out, pixels + (long long)row * frame->width, frame->width);
+			out += frame->width;
+		}
+	}
+	return rows->memory;
+}
+
+/*
+Selects what the compressors of the frames do once their dictionary is full, see lzw_clear_policy, for the frames added after the call.
+Every GIF decoder reads the frames of any of them, LZW_CLEAR_ON_RATIO is for the screenshots and the flat color animations,
+whose frames compress better with a dictionary that is not rebuilt every 4096 codes.
+*/
+void GIFWriter::set_clear_policy(int clear_policy)
+{
+	this->clear_policy = clear_policy;
+}
+
+/*
+Makes the compressors of the frames added after the call look codes ahead for a better ratio, see LZWCompress::set_lookahead.
+It costs a few times the time of a frame, so it is for the GIFs that are written once and downloaded many times, and add_frames keeps every thread busy with it.
+*/
+void GIFWriter::set_lookahead(int codes)
+{
+	this->lookahead = codes;
+}
+
+/*
+Adds a frame of frame->width * frame->height color indices in "pixels", with the position, delay, disposal, transparent_index, interlacing
+and the local palette(if local_palette is true) described by "frame", the rest of the description is ignored.
+-----------------
+The color indices must fit in the minimum code size of the palette, the rows are given in order and an interlaced frame is written in the 4 pass order(see order_rows).
+The output of the compressor is written straight into the GIF, in sub-blocks: we make room for compress_bound() bytes and let compress_into() write there.
+The compressor is kept for the next frame and reset(), so its table is allocated once per writer and not once per frame.
+When a pool is given, a frame of at least two stripes(see LZWCompress::compress_parallel) is compressed in stripes on the threads of the pool,
+with the same compressor as the owner of the stripes, which is for the very large frames, many small frames are better added in parallel with add_frames.
+Returns false if the frame could not be added.
+*/
+bool GIFWriter::add_frame(const uchar *pixels, const gif_frame *frame, ThreadPool *pool)
+{
+	if (frame->width < 0 || frame->height < 0 || (frame->width * frame->height > 0 && pixels == nullptr))
+		return false;
+
+	int pixel_count = frame->width * frame->height;
+	const uchar *ordered = order_rows(&rows, pixels, frame);
+	if (ordered == nullptr && pixel_count > 0)
+		return false;
+
+	int min_code_size;
+	reserve(GIF_FRAME_HEADER_SIZE);
+	pointer += put_frame_header(buffer + pointer, frame, &min_code_size);
+
+	if (compress == nullptr) {
+		compress = new LZWCompress(GIF_MAX_CODE_SIZE, CHILD_TABLE_ENGINE, allocator);
+		compress->set_framing(LZW_FRAMING_SUB_BLOCKS);
+	}
+	compress->set_clear_policy(clear_policy);
+	compress->set_lookahead(lookahead);
+	compress->reset(ordered, pixel_count, min_code_size);
+
+	if (pool != nullptr && pixel_count >= 2 * LZW_STRIPE_MIN_SIZE) {
+		int size = compress->compress_parallel(pool);
+		uchar *stream = compress->acquire_buffer(&size);
+		reserve(size);
+		::memcpy(buffer + pointer, stream, size);
+		pointer += size;
+		lzw_free(allocator, stream);
+		return true;
+	}
+
+	long long bound = LZWCompress::compress_bound(pixel_count, min_code_size, CHILD_TABLE_ENGINE, LZW_FRAMING_SUB_BLOCKS, 0, clear_policy);
+	reserve((int)bound);
+
+	int written = 0;
+	int status = compress->compress_into(buffer + pointer, (int)bound, &written);
+	pointer += written;
+	return status == LZW_DONE;
+}
+
+/*
+Type: Structure
+Explanation: What the tasks of GIFWriter::add_frames share.
+slots:		where the header and the compressed stream of each frame are written in the GIF buffer, each slot has room for the worst case.
+written:	the number of bytes written to each slot.
+workers:	the compressor each worker keeps for all the frames it compresses(GIFWriter::workers), it is reset for each frame.
+worker_rows:	the memory each worker puts the rows of the interlaced frames in order in(GIFWriter::worker_rows).
+*/
+struct encode_batch {
+	GIFWriter *writer;
+	uchar *buffer;
+	const uchar *const *pixels;
+	const gif_frame *frames;
+	const long long *slots;
+	int *written;
+	bool *encoded;
+	LZWCompress **workers;
+	gif_rows *worker_rows;
+};
+
+/*
+A task of GIFWriter::add_frames, writes the header of a frame and compresses it into its slot with the worker's compressor.
+The compressor is the one of many inputs in memory, which is available in every build configuration, and reset() gives it the frame as its input.
+It is created for GIF_MAX_CODE_SIZE, so its table has room for any minimum code size and reset() never has to allocate.
+*/
+void GIFWriter::encode_frame_task(void *context, int index, int worker)
+{
+	encode_batch *batch = (encode_batch*)context;
+	const gif_frame *frame = batch->frames + index;
+	uchar *out = batch->buffer + batch->slots[index];
+
+	int min_code_size
+		, header = batch->writer->put_frame_header(out, frame, &min_code_size)
+		, pixel_count = frame->width * frame->height;
+
+	LZWCompress *compress = batch->workers[worker];
+	if (compress == nullptr) {
+		compress =
+			batch->workers[worker] = new LZWCompress(GIF_MAX_CODE_SIZE, CHILD_TABLE_ENGINE, batch->writer->allocator);
+		compress->set_framing(LZW_FRAMING_SUB_BLOCKS);
+	}
+	const uchar *ordered = batch->writer->order_rows(batch->worker_rows + worker, batch->pixels[index], frame);
+	if (ordered == nullptr && pixel_count > 0) {
+		batch->encoded[index] = false;
+		batch->written[index] = 0;
+		return;
+	}
+	compress->set_clear_policy(batch->writer->clear_policy);
+	compress->set_lookahead(batch->writer->lookahead);
+	compress->reset(ordered, pixel_count, min_code_size);
+
+	int written = 0
+		, room = (int)(batch->slots[index + 1] - batch->slots[index]) - header;
+	batch->encoded[index] = compress->compress_into(out + header, room, &written) == LZW_DONE;
+	batch->written[index] = header + written;
+}
+
+/*
+Adds "count" frames at once, compressing them in parallel on the threads of the pool, frame i is pixels[i] described by frames[i] as for add_frame.
+-----------------
+Every frame gets a slot in the GIF buffer that is large enough for its header and compress_bound() bytes, the frames are compressed straight into their slots
+in parallel, and then the slots are moved down next to each other in order, so the frames are in the GIF in the order they were given.
+Each worker keeps one compressor for all the frames it compresses, and resets it for each frame, and the writer keeps them for its next add_frames,
+so the tables are allocated once per worker of the writer and not once per frame or per call.
+Returns false if any of the frames could not be added, the frames are added either way.
+*/
+bool GIFWriter::add_frames(ThreadPool *pool, const uchar *const *pixels, const gif_frame *frames, int count)
+{
+	if (count <= 0)
+		return true;
+	for (int i = 0; i < count; i++) {
+		if (frames[i].width < 0 || frames[i].height < 0 || (frames[i].width * frames[i].height > 0 && pixels[i] == nullptr))
+			return false;
+	}
+
+	long long *slots = new long long[count + 1];
+	slots[0] = pointer;
+	for (int i = 0; i < count; i++) {
+		slots[i + 1] = slots[i] + GIF_FRAME_HEADER_SIZE
+			+ LZWCompress::compress_bound(frames[i].width * frames[i].height, frame_code_size(frames + i), CHILD_TABLE_ENGINE, LZW_FRAMING_SUB_BLOCKS, 0, clear_policy);
+	}
+	reserve((int)(slots[count] - pointer));
+
+	int *written = new int[count];
+	bool *encoded = new bool[count];
+	if (worker_count < pool->size()) {
+		LZWCompress **more = new LZWCompress*[pool->size()];
+		gif_rows *more_rows = new gif_rows[pool->size()];
+		for (int worker = 0; worker < pool->size(); worker++) {
+			more[worker] = worker < worker_count ? workers[worker] : nullptr;
+			more_rows[worker] = worker < worker_count ? worker_rows[worker] : gif_rows{ nullptr, 0 };
+		}
+		delete[] workers;
+		delete[] worker_rows;
+		workers = more;
+		worker_rows = more_rows;
+		worker_count = pool->size();
+	}
+
+	encode_batch batch = { this, buffer, pixels, frames, slots, written, encoded, workers, worker_rows };
+	pool->run(count, encode_frame_task, &batch);
+
+	bool all = true;
+	for (int i = 0; i < count; i++) {
+		::memmove(buffer + pointer, buffer + slots[i], written[i]);
+		pointer += written[i];
+		all = all && encoded[i];
+	}
+
+	delete[] encoded;
+	delete[] written;
+	delete[] slots;
+	return all;
+}
+
+/*
+Ends the GIF with the trailer, and returns its size.
+*/
+int GIFWriter::finish()
+{
+	put_byte(GIF_TRAILER);
+	return pointer;
+}
+
+/*
+Returns the GIF, must be called after finish(), the user of the class is responsible for deallocating the buffer with lzw_free and the allocator of the writer.
+*/
+uchar *GIFWriter::acquire_buffer(int *buffer_size)
+{
+	*buffer_size = pointer;
+	return buffer;
+}
@@ -26,6 +26,31 @@
 #include <cstring>
 #include <iostream>
 
+/*
+The SSE2 and AVX2 probes are only built for x86, every other CPU uses the scalar probe.
+*/
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define HASH_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define HASH_TARGET_AVX2
+#else
+#define HASH_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+/*
+The tags and the entries are two separate loads, so we start loading the entry of the home slot while the tags are being compared,
+most of the strings are found at their home slot so by the time the tag matches the entry is on its way as well.
+*/
+#if defined(_MSC_VER) && defined(HASH_SIMD_X86)
+#define HASH_PREFETCH(address) _mm_prefetch((const char*)(address), _MM_HINT_T0)
+#elif defined(_MSC_VER)
+#define HASH_PREFETCH(address)
+#else
+#define HASH_PREFETCH(address) __builtin_prefetch(address)
+#endif
+
 /*
 While we use to have separate chaining for unoptimized code it is very poor as the code has to do a lot of memory allocations,
 so I decided to go for open addressing which is much faster as there is no memory allocation which is quite expensive for a large set of elements
@@ -72,6 +97,44 @@ uint HashTable::get_hashcode(char _char, int _preval, uint modulus) {
 	return((((_char * 2726656) + _char) ^ (_preval * 9931)) + _preval) & (modulus - 1);
 }
 
+/*
+The tag is made from different bits of the string than the hashcode, so strings that land next to each other rarely have the same tag.
+The epoch of the table is put in the high byte, so the tag can only match the slots written since the last clear.
+*/
+ushort HashTable::get_tag(char _char, int _preval)
+{
+	return (ushort)((epoch << 8) | 0x80 | (((((uint)_preval) << 8 | (uchar)_char) * 2654435769u) >> 25));
+}
+
+/*
+Returns true if the slot with the given tag was written in the current epoch, the other slots are empty.
+*/
+bool HashTable::is_used(ushort tag)
+{
+	return (uint)(tag >> 8) == epoch;
+}
+
+/*
+Allocates the columns for memory_size slots, only the tags have to be zeroed as the tag tells if the rest of the slot is valid.
+With the default allocator the tags come from ::calloc, so for large tables the zeroed pages are handed out by the system as they are touched instead of all at once.
+*/
+void HashTable::allocate_columns(hash_columns *columns, uint memory_size)
+{
+	columns->tags = (ushort*)lzw_alloc(allocator, (memory_size + HASH_TAG_MIRROR) * sizeof(ushort), true);
+	columns->entries = (hash_entry*)lzw_alloc(allocator, memory_size * sizeof(hash_entry));
+}
+
+/*
+Frees the columns allocated by allocate_columns.
+*/
+void HashTable::free_columns(hash_columns *columns)
+{
+	lzw_free(allocator, columns->tags);
+	lzw_free(allocator, columns->entries);
+	columns->tags = nullptr;
+	columns->entries = nullptr;
+}
+
 /*
 When the hash table is filled above a certain threshold that is HASH_FILL, we resize the hash_table
 ------------
@@ -80,38 +143,21 @@ In previous code we used to have used the prime numbers as the base for our hash
 void HashTable::expand_table()
 {
 	uint original_size = hash_memory_size;
-	hash_memory_size *= 2;// this->next_prime_above(hash_memory_size * HASH_EXPAND);
+	hash_memory_size *= HASH_EXPAND;// this->next_prime_above(hash_memory_size * HASH_EXPAND);
 
-	hash_struct *new_memory = (hash_struct*)::malloc(hash_memory_size * sizeof(hash_struct));
-	::memset(new_memory, 0, hash_memory_size * sizeof(hash_struct));
-
-	hash_struct *memory = hash_memory;
-	int i = original_size;
+	hash_columns new_memory;
+	allocate_columns(&new_memory, hash_memory_size);
 
 	//Scan through all the hash table buckets and re-map them into the new memory location
-	while (i--) {
-		/*
-		How we used to re-map in the unoptimized code
-		-------------------
-		if (*memory != 0) {
-			MyList<hash_struct> *h_temp = (*memory);
-			for (uint q = 0; q < h_temp->size(); q++) {
-				hash_struct h_s = *(h_temp->operator[](q));
-				add_private(new_memory, h_s._char, h_s._preval, h_s.code);
-			}
-			delete *memory;
-		}
-		*/
-
-		//First check if the bucket needs to be processed, by checking if the is_valid flag is set.
-		if (memory->is_valid) {
-			add_private(new_memory, memory->char_code, memory->previous_code, memory->code, memory->is_valid);
+	for (uint i = 0; i < original_size; i++) {
+		//First check if the bucket needs to be processed, by checking if the tag is used in the current epoch.
+		if (is_used(hash_memory.tags[i])) {
+			add_private(&new_memory, hash_memory_size, hash_memory.entries[i].char_code, hash_memory.entries[i].previous_code, hash_memory.entries[i].code, hash_memory.tags[i]);
 		}
-		++memory;
 	}
 
 	//After we have processed all the buckets, we throw away the old memory(::free) and set the pointer to the new memory location.
-	::free(hash_memory);
+	free_columns(&hash_memory);
 	hash_memory = new_memory;
 	this->hash_update_size = (uint)(this->hash_memory_size*HASH_FILL);
 }
@@ -119,36 +165,29 @@ void HashTable::expand_table()
 /*
 This method actually insert(s) an item into the hash_table by doing all the necessary hash calcuations and all other operations.
 */
-void HashTable::add_private(hash_struct *source_memory, char _char, int _preval, uint code, char valid)
+void HashTable::add_private(hash_columns *source_memory, uint memory_size, char _char, int _preval, uint code, ushort tag)
 {
 	/*
 	First get the hash value generated for the given set of _char, and _preval and then map the value to the location in the hash table data structure.
 	*/
-	hash_struct *memory_location = (source_memory + get_hashcode(_char, _preval, hash_memory_size));
-
-	//Allocate some space on stack to create the hash_struct data structure, that will be sent to the heap later.
-	hash_struct hash;
-	hash.char_code = _char;
-	hash.previous_code = _preval;
-	hash.code = code;
-	hash.is_valid = valid;
+	uint slot = get_hashcode(_char, _preval, memory_size);
 
 	/*
-	If the memory_location->valid is not 0 it means that the bucket is occupied and according to open addressing we must look for next available space,
-	and keep on doing so until we find one.
+	If the slot is used in the current epoch it means that the bucket is occupied and according to open addressing we must look for next available space,
+	and keep on doing so until we find one, once we have reached to the end of the table we start again from the beginning.
 	*/
-	while (memory_location->is_valid) {
-		++memory_location;
+	while (is_used(source_memory->tags[slot]))
+		slot = (slot + 1) & (memory_size - 1);
 
-		//Once we have reached to the end of the buffer's size, we start again from the beginning.
-		if (memory_location >= (source_memory + hash_memory_size))
-			memory_location = source_memory;
-	}
 	/*
-	If memory_location_>is_valid is 0, which mean the bucket is empty, just put the structure at that location
+	The bucket is empty, just put the fields at that slot, and keep the mirror of the first tags up to date.
 	*/
-	*memory_location = hash;
-	return;
+	source_memory->tags[slot] = tag;
+	if (slot < HASH_TAG_MIRROR)
+		source_memory->tags[memory_size + slot] = tag;
+	source_memory->entries[slot].previous_code = (uint)_preval;
+	source_memory->entries[slot].code = code;
+	source_memory->entries[slot].char_code = _char;
 }
 
 /*
@@ -160,7 +199,7 @@ void
 #endif
 	HashTable::add(char _char, int _preval, uint code)
 {
-	add_private(hash_memory, _char, _preval, code, 1);
+	add_private(&hash_memory, hash_memory_size, _char, _preval, code, get_tag(_char, _preval));
 
 	/*
 	If the hash_total_elements/hash_memory_size is above HASH_FILL then expand the table.
@@ -172,16 +211,144 @@ void
 }
 
 /*
-Adds the codes to hash table in such a way as they only work as a padding instead of being able to be used later
+1/3: Scans the slots one at a time, starting at the slot "index" until it finds the string or an empty slot.
 */
-void HashTable::add_special_codes(char _char, int _preval, uint code)
+int HashTable::probe_scalar(const hash_columns *columns, uint memory_size, uint index, ushort tag, char character, uint previous_code)
 {
-	add_private(hash_memory, _char, _preval, code, 2);
+	uint mask = memory_size - 1;
+	while (is_used(columns->tags[index])) {
+		if (columns->tags[index] == tag
+			&& columns->entries[index].previous_code == previous_code
+			&& columns->entries[index].char_code == character)
+			return (int)index;
+		index = (index + 1) & mask;
+	}
+	return -1;
+}
 
-	if (hash_total_elements > hash_update_size) {
-		expand_table();
+/*
+2/3: Compares the tags of 8 slots at once, only the slots before the first empty slot are part of the probe sequence,
+and only the slots among them whose tag matches are compared to the string, in the order the scalar probe would have visited them.
+The tags are 16 bits but _mm_movemask_epi8 gives us a bit per byte, so we only keep the lower bit of each tag.
+*/
+int HashTable::probe_sse2(const hash_columns *columns, uint memory_size, uint index, ushort tag, char character, uint previous_code)
+{
+#ifdef HASH_SIMD_X86
+	uint mask = memory_size - 1;
+	const __m128i wanted = _mm_set1_epi16((short)tag)
+		, current = _mm_set1_epi16((short)(epoch << 8))
+		, epoch_bits = _mm_set1_epi16((short)0xff00);
+
+	while (true) {
+		__m128i tags = _mm_loadu_si128((const __m128i*)(columns->tags + index));
+		uint matches = (uint)_mm_movemask_epi8(_mm_cmpeq_epi16(tags, wanted)) & 0x5555
+			, empties = ~(uint)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(tags, epoch_bits), current)) & 0x5555;
+
+		if (empties)
+			matches &= (empties - 1) & ~empties;
+
+		while (matches) {
+			uint slot = (index + (lowest_bit(matches) >> 1)) & mask;
+			if (columns->entries[slot].previous_code == previous_code
+				&& columns->entries[slot].char_code == character)
+				return (int)slot;
+			matches &= matches - 1;
+		}
+
+		if (empties)
+			return -1;
+		index = (index + 8) & mask;
 	}
-	++hash_total_elements;
+#else
+	return probe_scalar(columns, memory_size, index, tag, character, previous_code);
+#endif
+}
+
+/*
+3/3: Same as the SSE2 probe, but compares the tags of 16 slots at once.
+*/
+#ifdef HASH_SIMD_X86
+HASH_TARGET_AVX2
+#endif
+int HashTable::probe_avx2(const hash_columns *columns, uint memory_size, uint index, ushort tag, char character, uint previous_code)
+{
+#ifdef HASH_SIMD_X86
+	uint mask = memory_size - 1;
+	const __m256i wanted = _mm256_set1_epi16((short)tag)
+		, current = _mm256_set1_epi16((short)(epoch << 8))
+		, epoch_bits = _mm256_set1_epi16((short)0xff00);
+
+	while (true) {
+		__m256i tags = _mm256_loadu_si256((const __m256i*)(columns->tags + index));
+		uint matches = (uint)_mm256_movemask_epi8(_mm256_cmpeq_epi16(tags, wanted)) & 0x55555555u
+			, empties = ~(uint)_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(tags, epoch_bits), current)) & 0x55555555u;
+
+		if (empties)
+			matches &= (empties - 1) & ~empties;
+
+		while (matches) {
+			uint slot = (index + (lowest_bit(matches) >> 1)) & mask;
+			if (columns->entries[slot].previous_code == previous_code
+				&& columns->entries[slot].char_code == character)
+				return (int)slot;
+			matches &= matches - 1;
+		}
+
+		if (empties)
+			return -1;
+		index = (index + 16) & mask;
+	}
+#else
+	return probe_scalar(columns, memory_size, index, tag, character, previous_code);
+#endif
+}
+
+/*
+Checks what the CPU supports, and selects the best probe that is not above probe_level, returns the selected probe.
+*/
+int HashTable::select_probe(int probe_level)
+{
+	int supported = HASH_PROBE_SCALAR;
+#ifdef HASH_SIMD_X86
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	if (info[3] & (1 << 26))
+		supported = HASH_PROBE_SSE2;
+	// AVX2 also needs the operating system to save the YMM registers(OSXSAVE, and XCR0 bits 1 and 2).
+	if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6) {
+		__cpuidex(info, 7, 0);
+		if (info[1] & (1 << 5))
+			supported = HASH_PROBE_AVX2;
+	}
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		supported = HASH_PROBE_SSE2;
+	if (__builtin_cpu_supports("avx2"))
+		supported = HASH_PROBE_AVX2;
+#endif
+#endif
+	int selected = probe_level < supported ? probe_level : supported;
+
+	if (selected == HASH_PROBE_AVX2)
+		probe = &HashTable::probe_avx2;
+	else if (selected == HASH_PROBE_SSE2)
+		probe = &HashTable::probe_sse2;
+	else
+		probe = &HashTable::probe_scalar;
+	return selected;
+}
+
+/*
+Probes the hash_memory for the string, and returns its entry or nullptr.
+*/
+hash_entry *HashTable::lookup(char character, uint previous_code)
+{
+	uint index = get_hashcode(character, previous_code, hash_memory_size);
+	HASH_PREFETCH(hash_memory.entries + index);
+	int slot = (this->*probe)(&hash_memory, hash_memory_size, index, get_tag(character, previous_code), character, previous_code);
+	return slot >= 0 ? hash_memory.entries + slot : nullptr;
 }
 
 /*
@@ -189,22 +356,40 @@ The most important(or one of) function(s) that actually scans through the hash t
 */
 hash_struct HashTable::get(char character, unsigned int previous_code)
 {
-	hash_struct* hash_pointer = (hash_memory + get_hashcode(character, previous_code, hash_memory_size));
-	while (hash_pointer->is_valid) {
-		if (hash_pointer->is_valid == 1
-			&& hash_pointer->previous_code == previous_code
-			&& hash_pointer->char_code == character)
-			return *hash_pointer;
-		++hash_pointer;
-		if (hash_pointer >= hash_memory + hash_memory_size) {
-			hash_pointer = hash_memory;
-		}
+	/*
+	The root strings are not stored in the table, the code of a root string is its char_code.
+	*/
+	if (previous_code == (uint)-1) {
+		hash_struct root = { character, 1, (uchar)character, previous_code };
+		return root;
 	}
-	return { 0 };
+
+	hash_entry *entry = lookup(character, previous_code);
+	if (entry == nullptr)
+		return {};
+
+	hash_struct element;
+	element.char_code = entry->char_code;
+	element.is_valid = 1;
+	element.code = entry->code;
+	element.previous_code = entry->previous_code;
+	return element;
 }
 
 /*
-Returns the total number of elements that have been added to the hash table so far.
+Same as get, but returns just the code of the string or -1 if it does not exist, so the HashTable can be used in place of the other dictionary engines.
+*/
+int HashTable::find(char character, int previous_code)
+{
+	if (previous_code < 0)
+		return (uchar)character;
+
+	hash_entry *entry = lookup(character, (uint)previous_code);
+	return entry == nullptr ? -1 : (int)entry->code;
+}
+
+/*
+Returns the total number of elements that have been added to the hash table so far, including the implicit root codes and the clear and end_of_information codes.
 */
 uint HashTable::size()
 {
@@ -212,34 +397,47 @@ uint HashTable::size()
 }
 
 /*
-Purges and rebuilds the entire hash table.
+Purges the entire hash table, by moving it to the next epoch, so all the slots written before are empty from now on.
+We used to zero all the tags(and even before that the whole table) here for every clear code, now we only do it when the epoch wraps around.
+The table also keeps the size it has grown to, as the next dictionary is very likely to grow as large as the last one.
 */
 void HashTable::clear()
 {
-	if (hash_memory_size > (base_reset_size << 1))
-	{
-		::free(hash_memory);
-		hash_memory = (hash_struct*)::malloc(base_reset_size * sizeof(hash_struct));
-		::memset(hash_memory, 0, base_reset_size * sizeof(hash_struct));
-		hash_memory_size = base_reset_size;
+	if (++epoch > HASH_EPOCH_LIMIT) {
+		::memset(hash_memory.tags, 0, (hash_memory_size + HASH_TAG_MIRROR) * sizeof(ushort));
+		epoch = HASH_EPOCH_NONE + 1;
 	}
-	else
-		::memset(hash_memory, 0, hash_memory_size * sizeof(hash_struct));
 	hash_update_size = (uint)(this->hash_memory_size * HASH_FILL);
-	hash_total_elements = 0;
+	hash_total_elements = base_elements;
+}
+
+/*
+Purges the table the same way as clear(), for a stream whose codes start at start_width bits, the memory the table has grown to is kept.
+*/
+void HashTable::reset(int start_width)
+{
+	base_elements = (1 << start_width) + 2;
+	clear();
 }
 
 /*
-Instantiates the HashTable class with the given begin_size.
+Instantiates the HashTable class with the given begin_size, the size must be a power of two and at least HASH_TAG_MIRROR.
+The codes below (1<<start_width)+2 are the root codes and the clear and end_of_information codes, which are never stored in the table.
+The columns(and the columns the table grows into) come from the allocator.
 */
-HashTable::HashTable(int begin_size)
+HashTable::HashTable(int begin_size, int start_width, const lzw_allocator *allocator)
 {
-	hash_memory = (hash_struct*)::malloc(begin_size * sizeof(hash_struct));
-	::memset(hash_memory, 0, begin_size * sizeof(hash_struct));
+	this->allocator = allocator;
+	if (begin_size < HASH_TAG_MIRROR)
+		begin_size = HASH_TAG_MIRROR;
+	allocate_columns(&hash_memory, begin_size);
 	hash_memory_size =
 		base_reset_size = begin_size;
 	hash_update_size = (uint)(this->hash_memory_size * HASH_FILL);
-	hash_total_elements = 0;
+	base_elements =
+		hash_total_elements = (1 << start_width) + 2;
+	epoch = HASH_EPOCH_NONE + 1;
+	select_probe(HASH_PROBE_AVX2);
 }
 
 /*
@@ -247,5 +445,5 @@ Frees the memory used by the hash table structure.
 */
 HashTable::~HashTable()
 {
-	::free(hash_memory);
+	free_columns(&hash_memory);
 }
@@ -48,14 +48,16 @@ int LZWBase::read_into_buffer(unsigned char *buffer, int size, ::FILE *file) {
 /*
 LZWBase can be instantiated without any parameters as the only parameter it requires is optional and has an implicit value.
 */
-LZWBase::LZWBase(int start_width)
+LZWBase::LZWBase(int start_width, int max_width, const lzw_allocator *allocator)
 {
 	this->byte_default_start = start_width;
+	this->byte_max_width = max_width;
+	this->allocator = allocator;
 }
 
 /*
 When we need to expand the memory we provide the pointer of the buffer to this function, and this function copies all the buffer into the newly
-allocated memory of size(size) and sets the rest of memory upto size(new_size) to 0.
+allocated memory of size(size) and sets the rest of memory upto size(new_size) to 0, the memory comes from the allocator of the codec.
 ----------------------------------
 What do this function do?
 	First we allocate a new_memory value that will keep the address of the memory location that we need to return;
@@ -67,24 +69,25 @@ What do this function do?
 */
 void *LZWBase::extend_buffer(void *buffer, int size, int new_size) {
 	void *new_memory;
-	if ((new_memory = ::realloc(buffer, new_size)) == nullptr) {
-		new_memory = ::malloc(new_size);
-		::memset(new_memory, 0, new_size);
+	if ((new_memory = lzw_realloc(allocator, buffer, size, new_size)) == nullptr) {
+		new_memory = lzw_alloc(allocator, new_size, true);
 		::memcpy(new_memory, buffer, size);
-		::free(buffer);
+		lzw_free(allocator, buffer);
 	}
 	else ::memset(((char*)new_memory + size), 0, new_size - size);
 	return(new_memory);
 }
 
 /*
-1/2: Pushes the default items (usually whole ASCII table) to the MyList before processing any input.
+Pushes the default items (usually whole ASCII table) to the MyList before processing any input.
+The dictionary engines of the compressor do not need them, as their root codes are implicit.
 */
 void LZWBase::push_default_elements(MyList<storage_info> *dictionary) {
 	storage_info si = { 0 };
 	//Pushes all the required codes to the dictionary
 	for (int i = 0; i < (1 << this->byte_default_start); i++) {
 		si.char_code = (char)i;
+		si.first_char = (char)i;
 		si.previous_code = -1;
 		si.size = 1;
 		(*dictionary).push(si);
@@ -95,58 +98,46 @@ void LZWBase::push_default_elements(MyList<storage_info> *dictionary) {
 }
 
 /*
-2/2: Pushes the default items (usually whole ASCII table) to the HashTable before processing any input.
+1/2: Steps up the byte_width variable when the dictionary size is at the boundary of the size, as the decompression is always one step behind the compression
+So we step up one step later than the compressor alternative, but the byte_width never goes above byte_max_width.
+Once the dictionary is full, it is the encoder's job to send the clear code, until then we keep reading codes at byte_max_width bits and stop adding to the dictionary.
+Returns true when the dictionary is full.
 */
-void LZWBase::push_default_elements(HashTable *table)
-{
-	//Add default ascii codes to the hash table, again the full ASCII table most likely
-	for (int i = 0; i < (1 << this->byte_default_start); i++) {
-		(*table).add((char)i, -1, i);
-	}
-	//But in hash table we add the special codes in to the table differently, well, we don't even need to bother adding this to hash table
-	//As in hash table we don't have any indexes :TODO: pending
-	for (int i = 0; i < 2; i++) {
-		(*table).add_special_codes((char)i, -1, i);
+bool LZWBase::step_byte_width(MyList<storage_info> *dictionary, char *byte_width) {
+	if (dictionary->list_size() >= (((ulong64)1) << (*byte_width))
+		&& *byte_width < this->byte_max_width) {
+		++(*byte_width);
 	}
+	return dictionary->list_size() >= (((ulong64)1) << this->byte_max_width);
 }
 
 /*
-1/2: Steps up the byte_width variable when the dictionary size is at the boundary of the size, as the decompression is always one step behind the compression
-So we step up one step later than the compressor alternative, also when the byte_width is bigger than max_allowed we flush the list and re-push the default elements
+1/3: Resets the HashTable and byte_width to their state at the beginning of the stream, the HashTable does not store the default elements
+and its clear only moves it to the next epoch, so the reset does not depend upon the size of the table.
 */
-bool LZWBase::step_byte_width(MyList<storage_info> *dictionary, char *byte_width) {
-	if (dictionary->list_size() >= (unsigned int)(1 << (*byte_width))) {
-		++(*byte_width);
-		if (*byte_width > MAX_BYTE_LEN) {
-			*byte_width = (char)(this->byte_default_start);
-			dictionary->clear();
-			LZWBase::push_default_elements(dictionary);
-			step_byte_width(dictionary, byte_width);
-			return true;
-		}
-	}
-	return false;
+void LZWBase::manual_hash_clean(HashTable *table, uchar *byte_width)
+{
+	*byte_width = (char)(this->byte_default_start);
+	table->clear();
+	step_byte_width(table, byte_width);
 }
 
 /*
-2/2: Steps up byte_width when table has more elements than the (1<<byte_width) can store,
-contrary to dictionary the hash table has default sizes of huge numbers so we need to call this function with the table's counter for number of elements it contain
+2/3: Resets the CompactTable and byte_width, the CompactTable does not store the default elements so we don't need to push them again.
 */
-bool LZWBase::step_byte_width(HashTable *table, uchar *byte_width)
+void LZWBase::manual_hash_clean(CompactTable *table, uchar *byte_width)
 {
-	if (table->size() > (unsigned int)(1 << (*byte_width))) {
-		++(*byte_width);
-		if (*byte_width >= MAX_BYTE_LEN) {
-			return true;
-		}
-	}
-	return false;
+	*byte_width = (char)(this->byte_default_start);
+	table->clear();
+	step_byte_width(table, byte_width);
 }
 
-void LZWBase::manual_hash_clean(HashTable *table, uchar *byte_width)
+/*
+3/3: Resets the ChildTable and byte_width, same as the CompactTable the default elements are implicit.
+*/
+void LZWBase::manual_hash_clean(ChildTable *table, uchar *byte_width)
 {
 	*byte_width = (char)(this->byte_default_start);
 	table->clear();
-	LZWBase::push_default_elements(table);
 	step_byte_width(table, byte_width);
 }
@@ -23,107 +23,149 @@
 */
 
 #include "../Headers/LZWCompress.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LZW_RUN_SSE2
+#include <emmintrin.h>
+#endif
 
 //The code has been drastically reduced in the size, as we progress through our optimizations
 
 /*
-Writes N bits such that 0<N<=32 to the output buffer, and sets the appropriate variables.
+Writes N bits such that 0<N<=32 to the output buffer, N being the current byte_width.
+-----------------
+We used to write the code one byte at a time, "OR"ing it into a zeroed buffer with static loop counters and a boundary check per byte,
+now the BitWriter collects the codes in a 64 bit accumulator and flushes them a whole word at a time.
 */
 void __inline LZWCompress::write_multibyte_buffer(uint information)
 {
-	char iteration_a = (this->bit_pointer + byte_width)
-		, iteration_b = (iteration_a >> 3) + ((iteration_a & 0x7) > 0) // Optimized(no speed gains in testing) from: "(iteration_a / 8) + (iteration_a % 8 > 0);", since division is expensive
-		, bits_written = 0; // Stores the number of the bits that have already been written
-
-	/*
-	We know we need, i, j forever so making them static across functions saves a bit of time(~10 of ms)
-	*/
-	static char i = 0, j = 0;
-	for (i = 0, j = iteration_b - 1; i < iteration_b; ++i) {
-		char put_here = (8 - this->bit_pointer) // The number of bits that can be written to the byte we are currently on : ( 8 - already_used_bits )
-			, leaf; // leaf actually stores the data we will write ("OR") to the current byte
+	writer.write(information, byte_width);
+}
 
-		/*
-		When writing data over multiple byte boundaries with some code size N we have to process different byte boundaries differently
-		Eg: write 512 to buffer starting at index 0, we have to write 256 to first byte and 0 to first bit of second byte. here we have to process
-			the 2nd byte different.
-		*/
-		if (i == j) {
-			char size = (byte_width - bits_written)
-				, lshift = bits_written - this->bit_pointer;
+/*
+Returns how many of the first "limit" bytes of data are equal to value, comparing 16 bytes at a time with SSE2 where we have it, and 8 at a time otherwise.
+*/
+static inline int run_length(const uchar *data, int limit, uchar value)
+{
+	int length = 0;
+#ifdef LZW_RUN_SSE2
+	const __m128i wanted = _mm_set1_epi8((char)value);
+	for (; length + 16 <= limit; length += 16) {
+		uint differ = ~(uint)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + length)), wanted)) & 0xffff;
+		if (differ)
+			return length + lowest_bit(differ);
+	}
+#else
+	const ulong64 wanted = 0x0101010101010101ULL * value;
+	for (; length + 8 <= limit; length += 8) {
+		ulong64 word;
+		::memcpy(&word, data + length, 8);
+		if (word != wanted)
+			break;
+	}
+#endif
+	while (length < limit && data[length] == value)
+		++length;
+	return length;
+}
 
-			/*
-			Optimized from: "char lshift = byte_width - (size + *bit_pointer);"
-			We know that the following will work, Simplifying equations:
-			------------------------------------
-			byte_width - ((byte_width - bits_written) + *bit_pointer)
-			byte_width - (byte_width - bits_written) -*bit_pointer
-			byte_width - byte_width + bits_written - *bit_pointer
-			bits_written - *bit_pointer;
-			*/
+/*
+Pushes the point of the clear code(or the end_of_information code) we are about to write to the side index, if there is one.
+The output_offset is the number of input bytes that the codes before it stand for.
+*/
+void __inline LZWCompress::mark_clear(long long output_offset)
+{
+	if (index == nullptr || writer.framed)
+		return;
+	lzw_clear_point point = { writer.position(), byte_width, output_offset };
+	index->push(point);
+}
 
-			leaf = (char)(information >> lshift);
-			bits_written += size;
-			this->bit_pointer += size;
-		}
-		else {
-			bits_written += put_here;
-			/*
-			How much we shift depends upon how much space we have left, so 8 - number of bits already written
-			*/
-			char shift = 8 - (bits_written);
+/*
+Remembers where the dictionary began in the output and in the input, called after every clear code we write.
+*/
+void __inline LZWCompress::begin_dictionary()
+{
+	clear_bits = writer.position();
+	clear_input = input_base + buffer_pointer;
+}
 
-			/*
-			How can it be negative? Because we are doing big endian encoding, anyways it does gets negative sometimes.
-			*/
-			leaf = (char)(shift & 0x80 //No speed gain from "shift < 0"
-				? information >> -shift
-				: information << shift);
-			this->bit_pointer += put_here;
-		}
+/*
+Remembers the ratio of the dictionary that has just filled up, and begins the empty window LZW_CLEAR_ON_RATIO measures the frozen dictionary over.
+*/
+void LZWCompress::table_filled()
+{
+	slot_bits = writer.position();
+	slot_input = input_base + buffer_pointer;
+	fill_ratio =
+		settled_ratio = slot_input > clear_input ? (double)(slot_bits - clear_bits) / (slot_input - clear_input) : 0;
+	window_bits =
+		window_input = 0;
+	ring_count =
+		ring_next = 0;
+}
 
-		/*
-		We are writing to the compression buffer here, so this is where all your compressed data goes through no matter what.
-		*/
-		*(this->compression_buffer + this->compression_buffer_pointer) |= leaf; // Minor speed gain over array[index]=value;
+/*
+Returns true once the ratio of the frozen dictionary over the window of the last LZW_RATIO_SLOTS slots degrades, that is when an empty dictionary would do better.
+-----------------
+It is called for every code we write with a frozen dictionary, and only does anything once the slot being measured has LZW_RATIO_SLOT input bytes,
+the slot then slides into the window in place of the oldest one. The ratio degrades in one of two ways:
+1)	The window is worse than the fill_ratio, as a fresh dictionary compressed the input that filled this one better than it does the input now.
+	A window that is shorter than LZW_RATIO_SLOTS slots(right after the dictionary froze) is compared too, so a dictionary that does not fit the input
+	at all is cleared after a single slot.
+2)	A whole window moved away from the settled_ratio, worse or better, which means the input is not like the input that filled the dictionary anymore.
+	It is for a dictionary filled by a photograph that compresses a flat color area that follows it a little better than the photograph,
+	but nowhere near as well as a dictionary of the flat color area. The move must be LZW_RATIO_SHIFT_FLOOR bits per byte at least, as the ratios of
+	a flat color input are too small for their noise to be compared relatively.
+*/
+bool LZWCompress::ratio_degraded()
+{
+	long long input = input_base + buffer_pointer - slot_input;
+	if (input < LZW_RATIO_SLOT)
+		return false;
 
-		if (this->bit_pointer >> 3) { // Optimized from:(no speed gains tested) "if(*bit_pointer>8)"
-			++(this->compression_buffer_pointer);
-			this->bit_pointer &= 0x7; // Optimized from: "*(bit_pointer)%=8;", compiler would have done this optimization too.
-		}
+	long long bits = writer.position() - slot_bits;
+	slot_bits += bits;
+	slot_input += input;
+	if (ring_count == LZW_RATIO_SLOTS) {
+		window_bits -= ring_bits[ring_next];
+		window_input -= ring_input[ring_next];
+	}
+	else ++ring_count;
+	ring_bits[ring_next] = bits;
+	ring_input[ring_next] = input;
+	ring_next = (ring_next + 1) % LZW_RATIO_SLOTS;
+	window_bits += bits;
+	window_input += input;
 
-		int next_pointer = this->compression_buffer_pointer; // Checks the boundary for compression buffer and call expand function if required.
-		if (next_pointer == (this->compression_buffer_size - 1))
-			LZWBase::check_to_extend(
-			(char**)&compression_buffer
-				, &this->compression_buffer_size
-				, next_pointer);
+	double ratio = (double)window_bits / window_input;
+	if (ratio > fill_ratio + fill_ratio / LZW_RATIO_TOLERANCE)
+		return true;
+	if (ring_count == LZW_RATIO_SLOTS) {
+		double shift = ratio > settled_ratio ? ratio - settled_ratio : settled_ratio - ratio;
+		if (shift > LZW_RATIO_SHIFT_FLOOR && shift > settled_ratio / LZW_RATIO_SHIFT)
+			return true;
+		settled_ratio += (ratio - settled_ratio) / 8;
 	}
+	return false;
 }
 
 /*
 Constructor: different constructor(s) for different build configuration(s)
+All the memory of the compressor(the table and the output of compress()) comes from the allocator, or from ::malloc if it is nullptr.
 */
 LZWCompress::LZWCompress
 #ifdef FILE_READ_BUILD
-(std::FILE *file, int start_width)
+(std::FILE *file, int start_width, int engine, const lzw_allocator *allocator)
 #else
-(uchar *input_stream, int buffer_size, int start_width)
+(uchar *input_stream, int buffer_size, int start_width, int engine, const lzw_allocator *allocator)
 #endif
-	: LZWBase(start_width)
+	: LZWBase(start_width, lzw_engine_max_width(engine), allocator)
+	, writer() // The output memory is allocated by compress(), or given by the user to compress_into()
 {
+	writer.allocator = allocator;
 	this->default_byte_width =
 		this->byte_width = (char)start_width;
 
-	/*
-	Allocate some default buffer of size BUFFER_SIZE for compression_buffer
-	*/
-	compression_buffer = (uchar*)::malloc(BUFFER_SIZE);
-	/*
-	Also make sure it is Zeroed, because the "OR" operations that are going to take place later will not be very pleased to find garbage in the string.
-	*/
-	::memset(compression_buffer, 0, BUFFER_SIZE);
-
 #ifdef FILE_READ_BUILD
 	this->file_in = file;
 
@@ -134,139 +176,886 @@ LZWCompress::LZWCompress
 	file_size = ::ftell(file_in);
 	::fseek(file_in, 0, SEEK_SET);
 
-	buffer_size = LZWBase::read_into_buffer(buffer, sizeof buffer, file_in);
+	buffer = file_buffer;
+	buffer_size = LZWBase::read_into_buffer(file_buffer, sizeof file_buffer, file_in);
 #else
 	buffer = input_stream;
 	this->buffer_size = buffer_size;
 #endif
 
-	/*
-	Precompute the hash table's size so it is large enough to store a lot of entities before having to expand
-	*/
-	int compute = //HashTable::next_prime_above(
-		(int)((1 << (MAX_BYTE_LEN > 18 ? 19 : (MAX_BYTE_LEN + 1))));
-	//);
-	table = new HashTable(compute);
-	push_default_elements(table);
+	create_table(start_width, engine);
+}
+
+/*
+Constructor: the streaming compressor, available in every build configuration, the input is given a chunk at a time to feed()
+and the output is written to the sink as it is produced, BUFFER_SIZE bytes at a time.
+So the memory used does not depend on the size of the stream, as long as the dictionary does not either, that is for all the engines
+but the HashTable whose codes can grow up to MAX_BYTE_LEN bits.
+*/
+LZWCompress::LZWCompress(lzw_sink sink, void *sink_context, int start_width, int engine, const lzw_allocator *allocator)
+	: LZWBase(start_width, lzw_engine_max_width(engine), allocator)
+	, writer()
+{
+	writer.allocator = allocator;
+	this->default_byte_width =
+		this->byte_width = (char)start_width;
+
+#ifdef FILE_READ_BUILD
+	this->file_in = nullptr;
+#endif
+	buffer = nullptr;
+	buffer_size = 0;
+
+	this->sink = sink;
+	this->sink_context = sink_context;
+	this->input_finished = false;
+	stream_buffer = (uchar*)lzw_alloc(allocator, BUFFER_SIZE);
+	writer.bind(stream_buffer, BUFFER_SIZE);
+
+	create_table(start_width, engine);
+}
+
+/*
+Constructor: the compressor of many inputs in memory, available in every build configuration, it has no input until reset() gives it one.
+It allocates nothing but the table, the output is allocated by compress() or given by the user to compress_into(), as for the compressor of memory,
+so it is the one to keep for the frames of a GIF or the stripes of compress_parallel. start_width should be the widest the inputs are going to have(see reset).
+*/
+LZWCompress::LZWCompress(int start_width, int engine, const lzw_allocator *allocator)
+	: LZWBase(start_width, lzw_engine_max_width(engine), allocator)
+	, writer()
+{
+	writer.allocator = allocator;
+	this->default_byte_width =
+		this->byte_width = (char)start_width;
+
+#ifdef FILE_READ_BUILD
+	this->file_in = nullptr;
+#endif
+	buffer = nullptr;
+	buffer_size = 0;
+
+	create_table(start_width, engine);
+}
+
+/*
+Allocates the table of the selected engine only.
+*/
+void LZWCompress::create_table(int start_width, int engine)
+{
+	this->engine = engine;
+	this->table = nullptr;
+	this->compact_table = nullptr;
+	this->child_table = nullptr;
+
+	if (engine == COMPACT_TABLE_ENGINE) {
+		/*
+		The CompactTable is sized to the GIF code space, and it does not need the default elements.
+		*/
+		compact_table = new CompactTable(start_width, GIF_MAX_BYTE_LEN, allocator);
+	}
+	else if (engine == CHILD_TABLE_ENGINE) {
+		child_table = new ChildTable(start_width, allocator);
+	}
+	else {
+		/*
+		Precompute the hash table's size so it is large enough to store a lot of entities before having to expand,
+		a max_width narrower than MAX_BYTE_LEN(see set_max_width) bounds the codes, so the table is sized for all of them and never expands(see HASH_PRESIZE_LIMIT),
+		while the codes of the default max_width have no bound, so the table starts at 2^19 slots and expands as the dictionary grows.
+		*/
+		int width = this->byte_max_width >= MAX_BYTE_LEN ? 19 : this->byte_max_width + 1;
+		int compute = //HashTable::next_prime_above(
+			(int)(1 << (width > HASH_PRESIZE_LIMIT ? HASH_PRESIZE_LIMIT : width));
+		//);
+		table = new HashTable(compute, start_width, allocator);
+	}
+	reset_runs(start_width);
+}
+
+/*
+Clears the table of the selected engine the same way as for a clear code, and makes it ready for codes that start at start_width bits.
+*/
+void LZWCompress::reset_table(int start_width)
+{
+	if (compact_table != nullptr)
+		compact_table->reset(start_width);
+	else if (child_table != nullptr)
+		child_table->reset(start_width);
+	else
+		table->reset(start_width);
+	reset_runs(start_width);
+}
+
+/*
+Forgets the strings of repeated bytes, for an empty dictionary the longest one of each byte is the byte itself, the bytes above start_width bits have none.
+*/
+void LZWCompress::reset_runs(int start_width)
+{
+	for (int value = 0; value < 256; value++) {
+		bool root = start_width >= 8 || value < (1 << start_width);
+		run_top_code[value] = root ? value : -1;
+		run_top_length[value] = root ? 1 : 0;
+	}
+}
+
+/*
+Starts over with a new input whose codes start at start_width bits, with the same engine and framing,
+so compressing many small inputs(such as the frames of a GIF) only pays for the allocations once.
+-----------------
+Everything the compressor has allocated is kept, the table is just cleared the same way as for a clear code, which does not depend upon the size of the table:
+the HashTable and the CompactTable move to their next epoch(and only wipe their tags when the epoch wraps around), and the ChildTable zeroes the children of the codes that were added.
+The only exception is the ChildTable given a start_width wider than any it had before, as its size depends upon the start_width,
+so a compressor that is going to be reset for many minimum code sizes should be instantiated with the widest of them.
+The output memory of compress() belongs to the user once it is acquired, so the next compress() allocates new memory,
+while compress_into() never allocates, so a compressor that is reset and given its output with compress_into() allocates nothing at all.
+The input is used the same way as the input given to the constructor, in every build configuration.
+For the streaming compressor the input is ignored, and it begins a new stream to the same sink.
+*/
+void LZWCompress::reset(const uchar *input, int input_size, int start_width)
+{
+#ifdef FILE_READ_BUILD
+	file_in = nullptr;
+	file_size = 0;
+	iterate = 0;
+#endif
+	buffer = sink == nullptr ? input : nullptr;
+	buffer_size = sink == nullptr ? input_size : 0;
+	buffer_pointer = 0;
+
+	stage = COMPRESS_BEGIN;
+	previous_code = -1;
+	table_full = false;
+	after_stripe =
+		before_stripe = false;
+	index = nullptr;
+	input_base = 0;
+	if (this->byte_max_width <= start_width)
+		this->byte_max_width = start_width + 1;
+	this->byte_default_start = start_width;
+	this->default_byte_width =
+		this->byte_width = (uchar)start_width;
+	reset_table(start_width);
+
+	writer.reset();
+	input_finished = sink == nullptr;
+	if (sink != nullptr)
+		writer.bind(stream_buffer, BUFFER_SIZE);
 }
 
 /*
 Since the optimized version only have one giant size memory allocation, and that too is for the table only, so delete the table
-Also deallocating the compression_buffer is responsibility of the user of the class.
+Also deallocating the writer's buffer is responsibility of the user of the class, with the allocator of the compressor.
 */
 LZWCompress::~LZWCompress()
 {
+	lzw_free(allocator, stream_buffer);
 	delete table;
+	delete compact_table;
+	delete child_table;
+	for (int worker = 0; worker < stripe_worker_count; worker++)
+		delete stripe_workers[worker];
+	delete[] stripe_workers;
 }
 
 /*
 This is the function where all of your compression magic happens :)
-Also, you can safely discard the return type.
+It is written once for all the dictionary engines, each engine must provide find, add and size.
+-----------------
+It is a template over the engine and over the start_width and the byte_max_width too, which are 0 when they are only known at run time,
+so for the GIF configurations(see compress_engine) the clear code, the end_of_information code and the widths are all constants the compiler can fold,
+and the ChildTable indexes its children with a constant shift.
+The function stops and returns LZW_NEED_OUTPUT when the writer does not have the room for the codes it is about to write,
+it checks before it changes anything for the current input byte, so calling it again with more room continues exactly where it stopped.
+Returns LZW_DONE once the end_of_information code has been written.
 */
-int LZWCompress::compress()
+template<class Table, int StartWidth, int MaxWidth, bool Lookahead> int LZWCompress::compress_table(Table *engine_table)
 {
-	/*
-	When we begin compressing, we find the char_code for first character in the string and use it to initialize our previous_code.
-	*/
-	int previous_code = (uchar)(table->get(*buffer, (uint)-1).char_code);
-	++buffer_pointer;
+	const int start_width = StartWidth != 0 ? StartWidth : this->default_byte_width
+		, max_width = MaxWidth != 0 ? MaxWidth : this->byte_max_width;
+	const uint clear_code = 1u << start_width;
 
-	LZWBase::step_byte_width(table, &byte_width);
-	/*
-	GIF LZW Stream starts by sending out the clear code to the output stream.
-	*/
-	write_multibyte_buffer((1 << this->default_byte_width));
+	if (stage == COMPRESS_BEGIN) {
+		/*
+		The streaming compressor may not have any input yet, we need at least one byte to begin unless the stream is finished(and empty).
+		*/
+		if (buffer_pointer >= buffer_size && !input_finished)
+			return LZW_NEED_INPUT;
 
-#ifdef FILE_READ_BUILD
-	int iterate = 0;
-#endif // FILE_READ_BUILD
+		/*
+		The clear code is written at the width after the first step, which is never more than byte_max_width.
+		*/
+		if (!writer.has_room(max_width))
+			return LZW_NEED_OUTPUT;
 
-	char last_char_code = 0;
+		/*
+		When we begin compressing, we find the char_code for first character in the string and use it to initialize our previous_code.
+		An empty stream is just the clear code and the end_of_information code.
+		*/
+		if (buffer_pointer < buffer_size && Lookahead) {
+			previous_code = choose_code(engine_table);
+		}
+		else if (buffer_pointer < buffer_size) {
+			previous_code = table_ops<Table, StartWidth>::find(engine_table, buffer[buffer_pointer], -1);
+			++buffer_pointer;
+		}
 
-	/*
-	While we have data to process, process the data.
-	Oh!, just in case you need to have the ability to terminate the processing of your data, you can add a kill switch here.
-	*/
-	while (buffer_pointer < buffer_size) {
 		/*
-		We call hash table's get method which call get_hash and maps the return value to the location in the hash table's memory, and return a value if the code exists.
+		table_full is set once the dictionary has (1<<byte_max_width) codes, we then write one more code and then the clear code.
+		*/
+		table_full = step_width(engine_table, max_width);
+		/*
+		GIF LZW Stream starts by sending out the clear code to the output stream, a stripe that continues a stream has its clear code written by the stripe before it.
 		*/
-		hash_struct element = table->get(buffer[buffer_pointer], previous_code);
+		if (!after_stripe) {
+			mark_clear(0);
+			write_multibyte_buffer(clear_code);
+		}
+		begin_dictionary();
+		if (table_full && clear_policy != LZW_CLEAR_WHEN_FULL)
+			table_filled();
+		stage = COMPRESS_BODY;
+	}
 
+	if (stage == COMPRESS_BODY) {
 		/*
-		element.is_valid==1 means that the string already exists in the hash table, and we can continue to search for string with larger size.
+		While we have data to process, process the data.
+		Oh!, just in case you need to have the ability to terminate the processing of your data, you can add a kill switch here.
 		*/
-		if (element.is_valid) {
+		while (buffer_pointer < buffer_size) {
 			/*
-			If the string exists we set the previous_code to the current "element"'s code and last_char_code to its "char_code",
-			but we only use previous_code to look for string(s) and last_char_code is used in compression, such that a bigger string is not found.
+			We call hash table's get method which call get_hash and maps the return value to the location in the hash table's memory, and return a value if the code exists.
+			With the lookahead parsing the code we have already ends here, as choose_code matched it all at once.
 			*/
-			previous_code = element.code;
-			last_char_code = element.char_code;
-		}
-		else {
-			if (
+			int element = Lookahead ? -1 : table_ops<Table, StartWidth>::find(engine_table, buffer[buffer_pointer], previous_code);
+
+			/*
+			element > -1 means that the string already exists in the hash table, and we can continue to search for string with larger size.
+			*/
+			if (element > -1) {
+				/*
+				If the string exists we set the previous_code to the current element's code.
+				*/
+				previous_code = element;
+			}
+			else {
+				/*
+				We are going to write the code, and the clear code too if the table is full, both at the current byte_width.
+				*/
+				if (!writer.has_room(table_full ? (byte_width << 1) : byte_width))
+					return LZW_NEED_OUTPUT;
+
+				if (!table_full && (
 #ifdef FILE_READ_BUILD
-				iterate != this->file_size
-				||
+					iterate != this->file_size
+					||
 #endif
-				previous_code > -1) {
-				last_char_code = buffer[buffer_pointer];
+					previous_code > -1)) {
+					char last_char_code = buffer[buffer_pointer];
+
+					/*
+					A repeated byte one byte longer than the longest one we have is the new longest one.
+					*/
+					if (previous_code == run_top_code[(uchar)last_char_code]) {
+						run_top_code[(uchar)last_char_code] = (int)engine_table->size();
+						++run_top_length[(uchar)last_char_code];
+					}
+
+					/*
+					Now since we have came across a sequence that did not exist in our dictionary already
+					example: we had "ABC", which existed in the hash table, and we tried to check if "ABCD" exists,
+					which did not exits, so now we have to add it to our hashtable.
+					With the lookahead parsing the string is already there when the code ended short of the longest match, the decoder adds it all the same.
+					*/
+					if (Lookahead && table_ops<Table, StartWidth>::find(engine_table, last_char_code, previous_code) > -1)
+						table_ops<Table, StartWidth>::add_again(engine_table, last_char_code, previous_code, engine_table->size());
+					else
+						table_ops<Table, StartWidth>::add(engine_table, last_char_code, previous_code, engine_table->size());
+				}
 
 				/*
-				Now since we have came across a sequence that did not exist in our dictionary already
-				example: we had "ABC", which existed in the hash table, and we tried to check if "ABCD" exists,
-				which did not exits, so now we have to add it to our hashtable.
+				We always write the code for the last found match, since this branch will only be taken when there is a match failure.
 				*/
-				table->add(last_char_code, previous_code, table->size());
-			}
+				write_multibyte_buffer(previous_code);
 
-			/*
-			We always write the code for the last found match, since this branch will only be taken when there is a match failure.
-			*/
-			write_multibyte_buffer(previous_code);
+				previous_code = buffer[buffer_pointer];
+
+				/*
+				Now try to check if the byte_width is consistent, or it it needs to be incremented or reset.
+				When you purge the hash table, write a clear code to the output so that the decoder knows it has to clear the dictionary too,
+				unless the clear_policy keeps the full dictionary frozen, for good or until its ratio degrades.
+				*/
+				if (table_full) {
+					if (clear_policy == LZW_CLEAR_WHEN_FULL || (clear_policy == LZW_CLEAR_ON_RATIO && ratio_degraded())) {
+						mark_clear(input_base + buffer_pointer);
+						write_multibyte_buffer(clear_code);
+						manual_hash_clean(engine_table, &byte_width);
+						reset_runs(start_width);
+						table_full = false;
+						begin_dictionary();
+					}
+				}
+				else if ((table_full = step_width(engine_table, max_width)) && clear_policy != LZW_CLEAR_WHEN_FULL)
+					table_filled();
 
-			previous_code = buffer[buffer_pointer];
+				if (Lookahead) {
+					previous_code = choose_code(engine_table);
+					continue;
+				}
 
+				/*
+				The next string begins with a byte we have a long string of repeated bytes of, if the input repeats the byte at least as long
+				we would find every byte of that string in the dictionary one after another, so we just skip to its end, and the byte after it
+				is looked up as usual. This is where flat color images spend their time, the output is the very same.
+				*/
+				int run = run_top_length[buffer[buffer_pointer]];
+				if (run >= LZW_RUN_MIN && run <= buffer_size - buffer_pointer
+					&& run_length(buffer + buffer_pointer + 1, run - 1, buffer[buffer_pointer]) == run - 1) {
+					previous_code = run_top_code[buffer[buffer_pointer]];
+					buffer_pointer += run - 1;
+#ifdef FILE_READ_BUILD
+					iterate += run - 1;
+#endif
+				}
+
+			}
+			++buffer_pointer;
+
+#ifdef FILE_READ_BUILD
 			/*
-			Now try to check if the byte_width is consistent, or it it needs to be incremented or reset.
+			Now if we are reading directly from file, we have to check that the buffer_pointer does not go outside the boundary and we have to update
+			the buffer, when we are at the boundary.
 			*/
-			if (LZWBase::step_byte_width(table, &byte_width)) {
-				write_multibyte_buffer(1 << this->default_byte_width);
-				manual_hash_clean(table, &byte_width);
+			if (buffer_pointer >= (buffer_size) && file_in != nullptr) {
+				input_base += buffer_size;
+				buffer_pointer = 0;
+				buffer_size = LZWBase::read_into_buffer(file_buffer, BUFFER_SIZE, file_in);
+				if (buffer_size == 0) break; // if buffer_size = 0, we are at the end of the file, just break the loop.
 			}
-			//When you purge the hash table, write a clear code to the output so that the decoder knows it has to clear the dictionary too
+			++iterate;
+#endif // FILE_READ_BUILD
 
 		}
-		++buffer_pointer;
 
-#ifdef FILE_READ_BUILD
 		/*
-		Now if we are reading directly from file, we have to check that the buffer_pointer does not go outside the boundary and we have to update
-		the buffer, when we are at the boundary.
+		The streaming compressor has to wait for the next chunk of the input, the string we are matching might continue in it.
+		*/
+		if (!input_finished)
+			return LZW_NEED_INPUT;
+		stage = COMPRESS_END;
+	}
+
+	if (stage == COMPRESS_END) {
+		/*
+		The decoder steps up the byte_width after every code it reads, as it adds the last code to its dictionary one code later than us,
+		it expects the end_of_information code to be one bit wider if the next code we would have added needs it.
+		*/
+		uchar end_width = (engine_table->size() >= (((ulong64)1) << byte_width) && byte_width < max_width) ? byte_width + 1 : byte_width;
+		if (!writer.has_room_to_finish((previous_code > -1 ? byte_width : 0) + end_width))
+			return LZW_NEED_OUTPUT;
+
+		/*
+		if previous code is greater than -1 there is some unwritten information, that needs to be written to output.
 		*/
-		if (buffer_pointer >= (buffer_size)) {
-			buffer_size = LZWBase::read_into_buffer(buffer, BUFFER_SIZE, file_in);
-			if (buffer_size == 0) break; // if buffer_size = 0, we are at the end of the file, just break the loop.
-			buffer_pointer = 0;
+		if (previous_code > -1) {
+			write_multibyte_buffer(previous_code);
 		}
-		++iterate;
-#endif // FILE_READ_BUILD
+		byte_width = end_width;
+		mark_clear(input_base + buffer_pointer);
+
+		/*
+		Finally write the End of Information, or the clear code when the next stripe continues the stream, the decoder expects either at the same width.
+		We count the bits before the last byte is padded, which is the whole stream for the unframed stripes that compress() writes.
+		*/
+		write_multibyte_buffer(clear_code + (before_stripe ? 0 : 1));
+		stream_bits = (long long)writer.pointer * 8 + writer.bit_count;
+
+		//Flush whatever bits are still waiting in the writer's accumulator.
+		writer.finish();
+		stage = COMPRESS_DONE;
+	}
+	return LZW_DONE;
+}
+
+/*
+Steps up byte_width the same way as LZWBase::step_byte_width, with the byte_max_width given to us so it is a constant in compress_table when it can be.
+*/
+template<class Table> inline bool LZWCompress::step_width(Table *engine_table, int max_width)
+{
+	if (engine_table->size() > (((ulong64)1) << byte_width) && byte_width < max_width)
+		++byte_width;
+	return engine_table->size() >= (((ulong64)1) << max_width);
+}
+
+/*
+Returns the length of the longest string at position of the input that is in the dictionary, which is how far the greedy parsing would match from there.
+If codes is not nullptr, the code of the prefix of each length is kept at codes[length % LZW_LOOKAHEAD_SPAN], so the longest prefixes can be picked from it.
+*/
+template<class Table> int LZWCompress::match_length(Table *engine_table, int position, int *codes)
+{
+	int code = table_ops<Table, 0>::find(engine_table, buffer[position], -1)
+		, length = 1;
+	if (codes != nullptr)
+		codes[length % LZW_LOOKAHEAD_SPAN] = code;
+
+	while (position + length < buffer_size) {
+		int element = table_ops<Table, 0>::find(engine_table, buffer[position + length], code);
+		if (element < 0)
+			break;
+		code = element;
+		++length;
+		if (codes != nullptr)
+			codes[length % LZW_LOOKAHEAD_SPAN] = code;
+	}
+	return length;
+}
+
+/*
+Picks the code the lookahead parsing writes next for the input at buffer_pointer, and moves buffer_pointer past its string.
+-----------------
+The greedy parsing always takes the longest match, but a little shorter one can leave the next codes to match more, so we try ending the code at each of
+the LZW_LOOKAHEAD_SPAN longest prefixes of the match, and score each by how far it and the next lookahead greedy matches after it get into the input.
+The longest match teaches the dictionary a string one byte longer than itself, while a shorter one makes the decoder add a string the dictionary already has,
+which just takes up a code. So a shorter code has to get further by more than the length of the longest match(and LZW_LOOKAHEAD_GAIN, as the greedy
+matches we look ahead with only guess the parsing after it) to make up for the string it does not teach, else the dictionary stops growing and the codes
+get shorter and shorter, which costs more than the lookahead ever wins on periodic input.
+Once the dictionary is full and kept(see lzw_clear_policy) nothing is added either way, and the code that gets furthest wins.
+Every prefix of a string in the dictionary is in the dictionary, so the decoder sees nothing but the usual codes, it never knows how they were picked.
+*/
+template<class Table> int LZWCompress::choose_code(Table *engine_table)
+{
+	int codes[LZW_LOOKAHEAD_SPAN];
+	int position = buffer_pointer
+		, longest = match_length(engine_table, position, codes)
+		, shortest = longest > LZW_LOOKAHEAD_SPAN ? longest - LZW_LOOKAHEAD_SPAN + 1 : 1
+		, best = longest
+		, best_reach = -1
+		, margin = table_full ? 0 : longest + LZW_LOOKAHEAD_GAIN;
+
+	for (int length = longest; length >= shortest; --length) {
+		int reach = position + length;
+		for (int step = 0; step < lookahead && reach < buffer_size; ++step)
+			reach += match_length(engine_table, reach, nullptr);
+		if (best_reach < 0 || reach > best_reach + margin) {
+			best = length;
+			best_reach = reach;
+		}
+	}
+
+	buffer_pointer = position + best;
+#ifdef FILE_READ_BUILD
+	iterate += best;
+#endif
+	return codes[best % LZW_LOOKAHEAD_SPAN];
+}
+
+/*
+Runs compress_table for a GIF configuration, that is the CompactTable or the ChildTable with codes of StartWidth up to GIF_MAX_BYTE_LEN bits.
+*/
+template<int StartWidth> int LZWCompress::compress_gif()
+{
+	if (engine == CHILD_TABLE_ENGINE)
+		return compress_table<ChildTable, StartWidth, GIF_MAX_BYTE_LEN>(child_table);
+	return compress_table<CompactTable, StartWidth, GIF_MAX_BYTE_LEN>(compact_table);
+}
 
+/*
+Runs the compression with the dictionary engine selected in the constructor, until it is done or the writer runs out of room.
+-----------------
+This is the dispatcher of the compress_table instances, every minimum code size GIF allows(GIF_MIN_CODE_SIZE to GIF_MAX_CODE_SIZE) has an instance of its own
+for each of the GIF engines, and everything else(the HashTable, and start widths out of that range) runs the instance that reads the widths at run time.
+*/
+int LZWCompress::compress_engine()
+{
+	if (engine != HASH_TABLE_ENGINE && this->byte_max_width == GIF_MAX_BYTE_LEN && lookahead == 0) {
+		switch (this->default_byte_width) {
+		case 2: return compress_gif<2>();
+		case 3: return compress_gif<3>();
+		case 4: return compress_gif<4>();
+		case 5: return compress_gif<5>();
+		case 6: return compress_gif<6>();
+		case 7: return compress_gif<7>();
+		case 8: return compress_gif<8>();
+		}
 	}
 
 	/*
-	if previous code is greater than -1 there is some unwritten information, that needs to be written to output.
+	The lookahead parsing looks at the input past the current string, which the streaming compressor and the one reading a file may not have yet.
 	*/
-	if (previous_code > -1) {
-		write_multibyte_buffer(previous_code);
+	if (lookahead > 0 && sink == nullptr
+#ifdef FILE_READ_BUILD
+		&& file_in == nullptr
+#endif
+		) {
+		if (engine == COMPACT_TABLE_ENGINE)
+			return compress_table<CompactTable, 0, 0, true>(compact_table);
+		else if (engine == CHILD_TABLE_ENGINE)
+			return compress_table<ChildTable, 0, 0, true>(child_table);
+		return compress_table<HashTable, 0, 0, true>(table);
 	}
 
-	//Finally write the End of Information.
-	write_multibyte_buffer((1 << this->default_byte_width) + 1);
+	if (engine == COMPACT_TABLE_ENGINE)
+		return compress_table<CompactTable, 0, 0>(compact_table);
+	else if (engine == CHILD_TABLE_ENGINE)
+		return compress_table<ChildTable, 0, 0>(child_table);
+	return compress_table<HashTable, 0, 0>(table);
+}
+
+/*
+Compresses the input with the dictionary engine selected in the constructor, into memory that is allocated and grown as required.
+Returns the size of the compressed output, and the output must be taken with acquire_buffer and released by the user with lzw_free and the allocator(::free for the default one).
+Also, you can safely discard the return type.
+After compress_into() returned LZW_NEED_OUTPUT, the memory of the user cannot grow, so the rest of the stream is written to memory of our own,
+and the output taken with acquire_buffer follows the bytes that compress_into() wrote.
+*/
+int LZWCompress::compress()
+{
+	if (writer.buffer == nullptr || !writer.owned)
+		writer.allocate(BUFFER_SIZE); // Allocate some default buffer of size BUFFER_SIZE for the compressed output
+
+	while (compress_engine() == LZW_NEED_OUTPUT)
+		writer.reserve(writer.size - writer.pointer + 1);
+	return writer.pointer;
+}
+
+/*
+Compresses the input into the output memory given by the user, which is never reallocated.
+If the output is full before the stream is finished it returns LZW_NEED_OUTPUT, and it must be called again with fresh output memory
+and it continues from where it stopped, else it returns LZW_DONE. The bytes written to this output are returned in "written".
+An output of compress_bound() bytes is always enough for the whole stream in a single call.
+*/
+int LZWCompress::compress_into(uchar *output, int output_size, int *written)
+{
+	writer.bind(output, output_size);
+	int status = compress_engine();
+	writer.close_block();
+	*written = writer.pointer;
+	return status;
+}
+
+/*
+Type: Structure
+Explanation: What the tasks of LZWCompress::compress_parallel share.
+stripes:	the input of each stripe, and the stream it is compressed to with its length in bits, and the points of its clear codes when we keep a side index.
+workers:	the compressor each worker keeps for all the stripes it compresses(LZWCompress::stripe_workers), it is reset for each stripe.
+*/
+struct lzw_stripe {
+	const uchar *input;
+	int input_size;
+	uchar *output;
+	long long output_bits;
+	MyList<lzw_clear_point> *points;
+};
+
+struct stripe_batch {
+	LZWCompress *compress;
+	lzw_stripe *stripes;
+	int stripe_count;
+	LZWCompress **workers;
+};
+
+/*
+A task of compress_parallel, compresses a stripe into memory of its own with the worker's compressor, which is created with the engine of ours,
+and takes our start_width, max_width, clear_policy and lookahead each time it is reset, as they can change between the calls.
+Only the first stripe begins with the clear code and only the last one ends with the end_of_information code.
+*/
+void LZWCompress::compress_stripe_task(void *context, int index, int worker)
+{
+	stripe_batch *batch = (stripe_batch*)context;
+	LZWCompress *owner = batch->compress;
+	lzw_stripe *stripe = batch->stripes + index;
+
+	LZWCompress *compress = batch->workers[worker];
+	if (compress == nullptr)
+		compress =
+			batch->workers[worker] = new LZWCompress(owner->default_byte_width, owner->engine, owner->allocator);
+	compress->reset(stripe->input, stripe->input_size, owner->default_byte_width);
+	compress->set_max_width(owner->byte_max_width);
+	compress->set_clear_policy(owner->clear_policy);
+	compress->set_lookahead(owner->lookahead);
+	compress->after_stripe = index > 0;
+	compress->before_stripe = index < batch->stripe_count - 1;
+	compress->index = stripe->points;
 
-	if (bit_pointer) compression_buffer_pointer++;
-	return (compression_buffer_pointer);
+	int size;
+	compress->compress();
+	stripe->output = compress->acquire_buffer(&size);
+	stripe->output_bits = compress->stream_bits;
+}
+
+/*
+Compresses the input the same way as compress(), but splits it into stripes that are compressed in parallel on the threads of the pool,
+into one stream that is taken with acquire_buffer. Returns the size of the compressed output.
+-----------------
+A clear code can come anywhere in the stream, and the decoder starts over with an empty dictionary after it, exactly as it does at the beginning of the stream.
+So each stripe is compressed with a dictionary of its own, as a stream that ends with a clear code(at the width the decoder expects it there) instead of
+the end_of_information code, and the next stripe continues the stream without its own clear code. The stripes are then joined bit by bit, as they do not end on a byte.
+We lose a little of the ratio to the empty dictionary every stripe begins with, which is next to nothing for the GIF engines as they clear the dictionary
+every 4096 codes anyway, so every stripe is at least LZW_STRIPE_MIN_SIZE bytes. stripe_count defaults to the threads of the pool.
+The output is the same for any pool, as it only depends upon the stripes, and it is a valid stream for any decoder.
+The compressors of the workers are kept for the next call(see stripe_workers), so a compressor that is reset and compressed in parallel again allocates no tables.
+The points of the side index are collected per stripe and moved by where the stripe begins in the stream and in the input as the stripes are joined.
+It falls back to compress() for an input that is too small to split, and for the streaming compressor and a compressor that reads from a file.
+*/
+int LZWCompress::compress_parallel(ThreadPool *pool, int stripe_count)
+{
+	if (stripe_count <= 0)
+		stripe_count = pool->size();
+	if (stripe_count > buffer_size / LZW_STRIPE_MIN_SIZE)
+		stripe_count = buffer_size / LZW_STRIPE_MIN_SIZE;
+	if (stripe_count < 2 || sink != nullptr || stage != COMPRESS_BEGIN
+#ifdef FILE_READ_BUILD
+		|| file_in != nullptr
+#endif
+		)
+		return compress();
+
+	lzw_stripe *stripes = new lzw_stripe[stripe_count];
+	for (int i = 0; i < stripe_count; i++) {
+		int begin = (int)((long long)buffer_size * i / stripe_count)
+			, end = (int)((long long)buffer_size * (i + 1) / stripe_count);
+		stripes[i].input = buffer + begin;
+		stripes[i].input_size = end - begin;
+		stripes[i].points = index != nullptr && !writer.framed ? new MyList<lzw_clear_point>(allocator) : nullptr;
+	}
+	if (stripe_worker_count < pool->size()) {
+		LZWCompress **more = new LZWCompress*[pool->size()];
+		for (int worker = 0; worker < pool->size(); worker++)
+			more[worker] = worker < stripe_worker_count ? stripe_workers[worker] : nullptr;
+		delete[] stripe_workers;
+		stripe_workers = more;
+		stripe_worker_count = pool->size();
+	}
+
+	stripe_batch batch = { this, stripes, stripe_count, stripe_workers };
+	pool->run(stripe_count, compress_stripe_task, &batch);
+
+	long long bits = 0;
+	for (int i = 0; i < stripe_count; i++)
+		bits += stripes[i].output_bits;
+	if (writer.buffer == nullptr)
+		writer.allocate(BUFFER_SIZE);
+	writer.reserve(writer.framed_size((int)((bits + 7) >> 3)) + 1);
+
+	for (int i = 0; i < stripe_count; i++) {
+		if (stripes[i].points != nullptr) {
+			long long bit_base = writer.position()
+				, output_base = input_base + (stripes[i].input - buffer);
+			for (unsigned int point = 0; point < stripes[i].points->list_size(); point++) {
+				lzw_clear_point moved = *(*stripes[i].points)[point];
+				moved.bit_offset += bit_base;
+				moved.output_offset += output_base;
+				index->push(moved);
+			}
+			delete stripes[i].points;
+		}
+		writer.write_stream(stripes[i].output, stripes[i].output_bits);
+		lzw_free(allocator, stripes[i].output);
+	}
+	writer.finish();
+	buffer_pointer = buffer_size;
+	stage = COMPRESS_DONE;
+
+	delete[] stripes;
+	return writer.pointer;
+}
+
+/*
+Hands the output written so far to the sink, and points the writer to the beginning of the stream_buffer again.
+*/
+bool LZWCompress::drain_to_sink()
+{
+	writer.close_block();
+	if (writer.pointer > 0 && !sink(sink_context, writer.buffer, writer.pointer))
+		return false;
+	writer.bind(stream_buffer, BUFFER_SIZE);
+	return true;
+}
+
+/*
+Runs the compression until it needs more input or it is done, handing the output to the sink every time the stream_buffer is full.
+*/
+int LZWCompress::compress_to_sink()
+{
+	int status;
+	while ((status = compress_engine()) == LZW_NEED_OUTPUT) {
+		if (!drain_to_sink())
+			return LZW_SINK_FAILED;
+	}
+	return status;
+}
+
+/*
+Streaming: compresses the next chunk of the input, the chunk can be of any size and it is not used after the call returns.
+Returns LZW_NEED_INPUT once the whole chunk is processed, or LZW_SINK_FAILED.
+Only the whole stream_buffer(s) are handed to the sink, call flush() to hand over everything that is written so far.
+*/
+int LZWCompress::feed(const uchar *input, int input_size)
+{
+	if (sink == nullptr || input_finished)
+		return LZW_DONE;
+
+	buffer = input;
+	buffer_size = input_size;
+	buffer_pointer = 0;
+	int status = compress_to_sink();
+	input_base += input_size;
+	buffer = nullptr;
+	buffer_size =
+		buffer_pointer = 0;
+	return status;
+}
+
+/*
+Streaming: hands all the whole bytes of the codes written so far to the sink.
+The string we are matching right now is not written until we know where it ends, so the stream is only complete after finish().
+*/
+int LZWCompress::flush()
+{
+	if (sink == nullptr)
+		return LZW_DONE;
+
+	if (writer.pointer + 4 > writer.size) {
+		if (!drain_to_sink())
+			return LZW_SINK_FAILED;
+	}
+	writer.flush_bytes();
+	if (!drain_to_sink())
+		return LZW_SINK_FAILED;
+	return input_finished ? LZW_DONE : LZW_NEED_INPUT;
+}
+
+/*
+Streaming: ends the stream, writes the last code and the end_of_information code, and hands the rest of the output to the sink.
+Returns LZW_DONE, or LZW_SINK_FAILED.
+*/
+int LZWCompress::finish()
+{
+	if (sink == nullptr)
+		return LZW_DONE;
+
+	input_finished = true;
+	int status = compress_to_sink();
+	if (status != LZW_DONE)
+		return status;
+	return drain_to_sink() ? LZW_DONE : LZW_SINK_FAILED;
+}
+
+/*
+Returns the most bytes that compressing input_size bytes can ever output with the given start_width, engine, framing, max_width(see set_max_width,
+0 for the default of the engine, clamped the same way) and clear_policy.
+-----------------
+At worst every input byte is a code of its own, and the width of the n-th code after a clear code depends only on n,
+so we just add up the widths of input_size codes, the way the compressor steps its byte_width, plus all of the clear codes and the end_of_information code.
+Widths are counted a whole run at a time, so it takes at most a few steps per width.
+When the dictionary can be frozen we do not know where the clear codes come, so every code is counted at max_width bits,
+plus a clear code for every dictionary that could have filled up, as it takes a code per string added to fill one.
+*/
+long long LZWCompress::compress_bound(long long input_size, int start_width, int engine, int framing, int max_width, int clear_policy)
+{
+	int widest = lzw_engine_max_width(engine);
+	if (max_width <= 0 || max_width > widest)
+		max_width = widest;
+	if (max_width <= start_width)
+		max_width = start_width + 1;
+	ulong64 base = (((ulong64)1) << start_width) + 2
+		, codes = input_size > 0 ? (ulong64)input_size : 1
+		, bits = start_width + 1; // the clear code at the beginning of the stream
+
+	if (clear_policy != LZW_CLEAR_WHEN_FULL) {
+		ulong64 fill = (((ulong64)1) << max_width) > base ? (((ulong64)1) << max_width) - base : 1;
+		bits += (codes + codes / fill + 1) * max_width;
+		codes = 0;
+	}
+
+	while (codes) {
+		/*
+		The codes written while the dictionary has (2^(width-1), 2^width] codes are "width" bits wide, and the first run starts at base codes.
+		*/
+		for (int width = start_width + 1; width <= max_width && codes; width++) {
+			ulong64 low = (((ulong64)1) << (width - 1)) > base - 1 ? (((ulong64)1) << (width - 1)) : base - 1
+				, run = (((ulong64)1) << width) - low;
+			if (run > codes) run = codes;
+			bits += run * width;
+			codes -= run;
+		}
+
+		//The dictionary is full, so the encoder writes the clear code at byte_max_width bits and starts over.
+		if (codes)
+			bits += max_width;
+	}
+
+	//The end_of_information code.
+	bits += max_width;
+
+	//Every sub-block but the last one is full, and the stream is terminated by a sub-block of length 0.
+	ulong64 bytes = (bits + 7) >> 3;
+	if (framing == LZW_FRAMING_SUB_BLOCKS)
+		bytes += (bytes + GIF_SUB_BLOCK_SIZE - 1) / GIF_SUB_BLOCK_SIZE + 1;
+	return (long long)bytes;
+}
+
+/*
+Selects how the compressed stream is laid out, see lzw_framing, it must be called before anything is compressed.
+With LZW_FRAMING_SUB_BLOCKS the output is GIF image data(without the minimum code size byte), written straight into sub-blocks,
+every sub-block is full except the last one, and the ones that end where compress_into() or the sink is handed the output.
+*/
+void LZWCompress::set_framing(int framing)
+{
+	writer.framed = framing == LZW_FRAMING_SUB_BLOCKS;
+}
+
+/*
+Keeps a side index of the stream as it is compressed, a point(see lzw_clear_point) is pushed to the index for every clear code that is written,
+and one more for the end_of_information code, so the decoder can decode the stream from any of its clear codes with decompress_parallel.
+It must be called before anything is compressed, and again after every reset(), as reset() forgets the index, the index must live until the stream is done.
+The bit offsets are counted in the codes only, so the index is only kept for the unframed streams.
+*/
+void LZWCompress::set_index(MyList<lzw_clear_point> *index)
+{
+	this->index = index;
+}
+
+/*
+Sets the widest code the compressor writes, so the dictionary is full at (1<<max_width) codes, it must be called before anything is compressed.
+The default is MAX_BYTE_LEN for the HashTable and GIF_MAX_BYTE_LEN for the other engines, whose tables are sized for that many codes,
+so max_width is clamped to their default and to above the start_width. The decoder must be instantiated with the same max_width.
+-----------------
+The HashTable's codes grow up to 32 bits by default and it never clears(not before 2^32 codes anyway), so its memory grows with the input,
+a narrower max_width bounds it, and the HashTable is sized again for it. Only the GIF engines at GIF_MAX_BYTE_LEN run the specialized compress_table.
+*/
+void LZWCompress::set_max_width(int max_width)
+{
+	int widest = lzw_engine_max_width(engine);
+	if (max_width > widest)
+		max_width = widest;
+	if (max_width <= this->default_byte_width)
+		max_width = this->default_byte_width + 1;
+	if (max_width == this->byte_max_width)
+		return;
+
+	this->byte_max_width = max_width;
+	if (engine == HASH_TABLE_ENGINE) {
+		delete table;
+		create_table(this->default_byte_width, engine);
+	}
+}
+
+/*
+Selects what the compressor does once its dictionary is full, see lzw_clear_policy, it must be called before anything is compressed,
+and it is kept by reset(). A compressor that freezes its dictionary needs the compress_bound of that clear_policy.
+*/
+void LZWCompress::set_clear_policy(int clear_policy)
+{
+	this->clear_policy = clear_policy;
+}
+
+/*
+Makes the compressor look codes ahead of the greedy parsing to pick the code that gets furthest(see choose_code), from 0, the greedy parsing,
+up to LZW_LOOKAHEAD_MAX codes, for a better ratio at a few times the time. It is kept by reset(), and only the compressors of input in memory
+use it, the streaming compressor and the one reading a file stay greedy. The output is an ordinary stream and the bound of compress_bound holds.
+*/
+void LZWCompress::set_lookahead(int codes)
+{
+	this->lookahead = codes < 0 ? 0 : (codes > LZW_LOOKAHEAD_MAX ? LZW_LOOKAHEAD_MAX : codes);
 }
 
 /*
@@ -274,6 +1063,6 @@ Returns the buffer information, and must be called after you have called compres
 */
 unsigned char * LZWCompress::acquire_buffer(int *size)
 {
-	*size = compression_buffer_pointer;
-	return compression_buffer;
+	*size = writer.pointer;
+	return writer.buffer;
 }
@@ -23,50 +23,47 @@
 */
 
 #include "../Headers/LZWDecompress.h"
-
-/*
-Walks down the complete structure heirarchy to find the first storage_info struct that does not have any back reference
-*/
-char LZWDecompress::get_first_byte(storage_info * info)
-{
-	while (info->previous_code != -1)
-		info = (*dictionary).operator[](info->previous_code);
-	return info->char_code;
-}
+#include <limits.h>
 
 /*
 This function read what is written by write_multibyte_buffer
+-----------------
+We used to load an unaligned "uint" from the compressed_data_buffer for each code, which could read past the end of the buffer,
+and the BitReader now does the job while only loading from the memory once every several codes.
 */
-int LZWDecompress::read_next_bits()
+int __inline LZWDecompress::read_next_bits()
 {
-	// Since LZW stream and both intel x86 is big endian the following is possible
-	unsigned int i = *(uint*)(this->compressed_data_buffer + this->compressed_data_pointer);
-	i = i >> (this->bit_pointer); // To clear extra bits while reading
-	i = i & ((1 << (byte_width)) - 1); // Optimized from: "i=i<<shift;i=i>>shift;"
-
-	this->bit_pointer += byte_width;
-	if (this->bit_pointer >= this->default_byte_width) {
-		(this->compressed_data_pointer) += (this->bit_pointer >> 3);
-		this->bit_pointer %= this->default_byte_width;
-	}
-	return(i);
+	return (int)reader.read((uchar)byte_width);
 }
 
 /*
 This function actually does the decompression, and puts the decompressed text to output, and add it to dictionary too.
+StartWidth and MaxWidth are the widths when they are known at compile time, else 0, see decode_codes.
 */
-void LZWDecompress::read_compressed_stream(uint index_code)
+template<int StartWidth, int MaxWidth> void LZWDecompress::read_compressed_stream(uint index_code)
 {
+	const int start_width = StartWidth != 0 ? StartWidth : this->default_byte_width
+		, max_width = MaxWidth != 0 ? MaxWidth : this->byte_max_width;
+
 	/*
 	Why do we have can_push, because we cannot have the function adding values into dictionary that already exist.
+	Also once the dictionary is full(at 1<<max_width codes) we keep decoding with it as it is, until the encoder sends the clear code.
 	*/
-	if (can_push) {
-		storage_info *node = (*dictionary)[((index_code >= dictionary->list_size()) ? last : index_code)];
+	if (can_push && dictionary->list_size() < (((ulong64)1) << max_width)) {
+		/*
+		The new string is the last string followed by the first character of the current string, and when the current code is the one
+		we are just adding(the encoder was one step ahead of us) the current string starts with the last string, so its first character is the same.
+		Both the characters are stored in the structures, so we never have to walk the back references here.
+		*/
+		storage_info *previous = (*dictionary)[last]
+			, *node = (index_code >= dictionary->list_size()) ? previous : (*dictionary)[index_code];
 
 		storage_info info;
-		info.char_code = get_first_byte(node);
+		info.char_code = node->first_char;
+		info.first_char = previous->first_char;
 		info.previous_code = last;
-		info.size = (*dictionary).operator[](last)->size + 1;
+		info.size = previous->size + 1;
+		info.position = last_position;
 		(*dictionary).push(info);
 	}
 	else {
@@ -74,7 +71,7 @@ void LZWDecompress::read_compressed_stream(uint index_code)
 		last = -1;
 	}
 
-	if (index_code < 256) {
+	if (index_code < (uint)(1 << start_width)) {
 		// If index_code is a basic code (is in ASCII), just write it at one byte
 		lastchar = (char)index_code;
 	}
@@ -85,67 +82,88 @@ void LZWDecompress::read_compressed_stream(uint index_code)
 		lastchar = (*dictionary)[index_code]->char_code;
 	}
 
-	//Now write the whole sequence string to the output buffer(decompression_buffer)
-	add_to_buffer(index_code);
+	//Now the whole sequence string is to be written to the output, it starts where the output is right now.
+	pending_code = index_code;
+	pending_offset = 0;
+	last_position = this->decompression_buffer_pointer;
 
 	//Set the last code found
 	last = index_code;
 }
 
 /*
-This functions appends a string to the decompressed_buffer(or any other buffer)
+Writes "count" characters of the string of "info" starting at the character number "from", to the destination.
+-----------------
+We used to walk the back references here writing one character at a time from the end of the string, which is a dependent load per character.
+Now the string minus its last character is copied from where it was written before(info->position) with a single ::memcpy,
+the source always ends at or before where we begin writing, even when the code is the one that was just added, so the copy never overlaps.
+We can only do that when the source is still in the output memory we have, for decompress_into() the earlier output memory belongs to the user,
+so in that case we walk the back references as before.
 */
-void LZWDecompress::add_to_buffer(int code)
+void LZWDecompress::write_string(storage_info *info, int from, int count, char *destination)
 {
-	storage_info *info = (*dictionary).operator[](code);
-	int size = info->size
-		, update_size = this->decompression_buffer_size;
-	bool buffer_grew = false;
-
-	/*
-	Loop through while checking if update_size*2 would be enough to store the new string, we need to make sure we have enough memory to store the new string
-	*/
-	while (update_size < (this->decompression_buffer_pointer + info->size)) {
-		update_size <<= BUFFER_GROW_SIZE;
-		buffer_grew = true;
+	int size = info->size;
+
+	if (info->previous_code == -1 || info->position >= this->output_window) {
+		int copy = size - 1 - from;
+		if (copy > count) copy = count;
+		if (copy > 0)
+			::memcpy(destination, this->output_base + (info->position - this->output_window) + from, copy);
+
+		//The last character in the newly copied string would the character at the current "code" in the list dictionary.
+		if (from + count == size)
+			destination[count - 1] = info->char_code;
+		return;
 	}
 
-	// If we would have to expand/increase the current buffer, we would have to call appropriate methods to do so
-	if (buffer_grew) {
-		this->decompression_buffer = (char*)LZWBase::extend_buffer(this->decompression_buffer, this->decompression_buffer_size, update_size);
-		this->decompression_buffer_size = update_size;
+	int index = size - 1;
+	while (index >= from + count) {
+		info = (*dictionary)[info->previous_code];
+		--index;
 	}
+	while (true) {
+		destination[index - from] = info->char_code;
+		if (index == from) break;
+		info = (*dictionary)[info->previous_code];
+		--index;
+	}
+}
 
-	// In optimized code we increase performance by reducing memory operations such as move and copy.
-	char *buffer_copy_begin = (this->decompression_buffer + this->decompression_buffer_pointer);
-	char *buffer_copy_end = buffer_copy_begin + (info->size - 1);
-
-	//The last character in the newly copied string would the character at the current "code" in the list dictionary.
-	*buffer_copy_end = info->char_code;
-	--buffer_copy_end;
-
-	// If the code we have to copy is more than one byte
-	if (code) {
-		while (info->previous_code != -1
-			&& buffer_copy_end >= buffer_copy_begin) {
-			info = (*dictionary).operator[](info->previous_code);
-			*buffer_copy_end = info->char_code;
-			--buffer_copy_end;
-		}
+/*
+Writes as much of the pending string as fits in the output, and returns true if the whole string has been written.
+*/
+bool LZWDecompress::write_pending()
+{
+	storage_info *info = (*dictionary)[pending_code];
+	int count = info->size - pending_offset
+		, room = this->output_end - this->decompression_buffer_pointer;
+	if (count > room) count = room;
+
+	if (count > 0) {
+		write_string(info, pending_offset, count, this->output_base + (this->decompression_buffer_pointer - this->output_window));
+		this->decompression_buffer_pointer += count;
+		pending_offset += count;
 	}
-	this->decompression_buffer_pointer += size;
+
+	if (pending_offset < info->size)
+		return false;
+	pending_code = -1;
+	return true;
 }
 
 /*
 Constructor: Initializes list structure and fills with default values.
+All the memory of the decompressor(the dictionary and the output of decompress()) comes from the allocator, or from ::malloc if it is nullptr.
+max_width must be the widest code of the compressor, for the streams of the GIF engines it is GIF_MAX_BYTE_LEN and not the default, see lzw_engine_max_width.
 */
 LZWDecompress::LZWDecompress
 #ifdef FILE_READ_BUILD
-(std::FILE *file, int start_width)
+(std::FILE *file, int start_width, int max_width, const lzw_allocator *allocator)
 #else
-(unsigned char *memory, int buffer_size, int start_width)
+(unsigned char *memory, int buffer_size, int start_width, int max_width, const lzw_allocator *allocator)
 #endif
-	:LZWBase(start_width) 
+	:LZWBase(start_width, max_width, allocator)
+	, reader(nullptr, 0)
 {
 	this->default_byte_width =
 		this->byte_width = (char)start_width;
@@ -153,48 +171,178 @@ LZWDecompress::LZWDecompress
 #ifdef FILE_READ_BUILD
 	file_in = file;
 
-	compressed_data_buffer = (unsigned char*)::malloc(BUFFER_SIZE);
-	::memset(compressed_data_buffer, 0, BUFFER_SIZE);
+	compressed_data_buffer = (unsigned char*)lzw_alloc(allocator, BUFFER_SIZE, true);
 
 	compressed_data_size = LZWBase::read_into_buffer((uchar*)compressed_data_buffer, BUFFER_SIZE, file_in);
 #else
 	compressed_data_buffer = memory;
 	compressed_data_size = buffer_size;
 #endif
+	reader.rebind(compressed_data_buffer, compressed_data_size);
 
-	/*
-	Allocate buffer to put the decompressed output, and initialize it to zero, in decompression initilization is 0 is not critical.
-	*/
-	decompression_buffer = (char*)::malloc(BUFFER_SIZE);
-	::memset(decompression_buffer, 0, BUFFER_SIZE);
+	create_dictionary();
+}
 
-	/*
-	Now instantiate the MyList class, to create the dictionary.
-	*/
-	dictionary = new MyList<storage_info>();
+/*
+Constructor: the streaming decompressor, available in every build configuration, the compressed stream is given a chunk at a time to feed()
+and the output is taken a piece at a time with decompress_into(), so the memory used is the dictionary and nothing more.
+*/
+LZWDecompress::LZWDecompress(int start_width, int max_width, const lzw_allocator *allocator)
+	:LZWBase(start_width, max_width, allocator)
+	, reader(nullptr, 0)
+{
+	this->default_byte_width =
+		this->byte_width = (char)start_width;
+	this->input_finished = false;
+	this->streaming = true;
+
+	create_dictionary();
+}
+
+/*
+Now instantiate the MyList class, to create the dictionary.
+*/
+void LZWDecompress::create_dictionary()
+{
+	dictionary = new MyList<storage_info>(allocator);
 	LZWBase::push_default_elements(dictionary);
 
 	LZWBase::step_byte_width(dictionary, &byte_width);
 }
 
 /*
-The user of the class is responsible for deallocating the decompression_buffer
+Starts over with a new compressed stream whose codes start at start_width bits, with the same max_width and framing,
+so decompressing many small streams(such as the frames of a GIF) only pays for the allocations once.
+-----------------
+The dictionary keeps its memory, when start_width is the same as before the codes after the default elements are just dropped the same way as for a clear code,
+else the default elements for start_width are pushed again into the memory the dictionary already has, which always has room for at least DEFAULT_MEMORY_ELEMENTS elements.
+The output memory of decompress() belongs to the user once it is acquired, so the next decompress() allocates new memory,
+while decompress_into() never allocates, so a decompressor that is reset and given its output with decompress_into() allocates nothing at all.
+The input is read from memory in every build configuration, and for the streaming decompressor it is the first chunk, the same as giving it to feed().
+*/
+void LZWDecompress::reset(const uchar *input, int input_size, int start_width)
+{
+	file_in = nullptr;
+	reader.reset(input, input_size);
+	input_finished = !streaming;
+
+	decompression_buffer = nullptr;
+	decompression_buffer_size = BUFFER_SIZE;
+	decompression_buffer_pointer = 0;
+	output_base = nullptr;
+	output_window =
+		output_end = 0;
+
+	pending_code = -1;
+	pending_offset = 0;
+	finished =
+		bad_code = false;
+	stop_clears = 0;
+	can_push = false;
+	last = -1;
+	last_position = 0;
+	lastchar = 0;
+
+	if (start_width == this->default_byte_width)
+		dictionary->truncate((1 << start_width) + 2);
+	else {
+		this->byte_default_start = start_width;
+		dictionary->truncate(0);
+		LZWBase::push_default_elements(dictionary);
+	}
+	this->default_byte_width =
+		this->byte_width = (char)start_width;
+	LZWBase::step_byte_width(dictionary, &byte_width);
+}
+
+/*
+Selects how the compressed stream is laid out, see lzw_framing, it must be called before anything is decompressed.
+With LZW_FRAMING_SUB_BLOCKS the length bytes are skipped as the codes are read, and the stream ends at the terminating sub-block
+even if the end_of_information code is missing.
+*/
+void LZWDecompress::set_framing(int framing)
+{
+	reader.framed = framing == LZW_FRAMING_SUB_BLOCKS;
+}
+
+/*
+Streaming: gives the next chunk of the compressed stream, the chunk can be of any size, even a single byte, and a code can begin in one chunk and end in the next.
+The chunk is read by the following calls to decompress_into() and it must stay valid until one of them returns LZW_NEED_INPUT,
+by then all of its bytes have been taken and the next chunk can be given.
+*/
+void LZWDecompress::feed(const uchar *input, int input_size)
+{
+	reader.rebind(input, input_size);
+}
+
+/*
+Streaming: tells the decompressor there is no more input, so the stream ends when the bits run out even without the end_of_information code.
+*/
+void LZWDecompress::finish_input()
+{
+	input_finished = true;
+}
+
+/*
+The user of the class is responsible for deallocating the decompression_buffer, with lzw_free and the allocator of the decompressor
 */
 LZWDecompress::~LZWDecompress()
 {
-#ifdef FILE_READ_BUFFER
-	::free(compressed_data_buffer);
-#endif // FILE_READ_BUFFER
+#ifdef FILE_READ_BUILD
+	lzw_free(allocator, compressed_data_buffer);
+#endif // FILE_READ_BUILD
 
 	delete dictionary;
 }
 
-void LZWDecompress::decompress()
+/*
+Reads and decodes the codes until the end of the stream, or until the output is full in which case it returns LZW_NEED_OUTPUT,
+or until a code it cannot have in which case it returns LZW_BAD_CODE, and keeps returning it.
+The string of a code is written after the code is read and the dictionary is updated, so if we stop in the middle of a string
+we only have to finish writing it when we are called again.
+-----------------
+It is a template over the start_width and the byte_max_width, which are 0 when they are only known at run time, the same way as LZWCompress::compress_table,
+so for the GIF configurations the clear code, the end_of_information code and the width steps are constants, see decode() for the instances we have.
+*/
+template<int StartWidth, int MaxWidth> int LZWDecompress::decode_codes()
 {
-	const uint clear_code = 1 << this->default_byte_width
-		, end_of_information = (1 << this->default_byte_width) + 1;
+	const int start_width = StartWidth != 0 ? StartWidth : this->default_byte_width
+		, max_width = MaxWidth != 0 ? MaxWidth : this->byte_max_width;
+	const uint clear_code = 1 << start_width
+		, end_of_information = (1 << start_width) + 1;
+
+	while (true) {
+		if (pending_code != -1 && !write_pending())
+			return LZW_NEED_OUTPUT;
+		if (finished)
+			return bad_code ? LZW_BAD_CODE : LZW_DONE;
+
+		/*
+		We have to do additional processing, if we are reading from files, just for the fact that the code can span over multiple buffers.
+		Once the reader is about to run out of bits, we move the last bytes of the buffer into its accumulator, refill the buffer with fresh
+		data from the file and point the reader to it, so the bits of a code that spans the two buffers are just joined in the accumulator.
+		*/
+#ifdef FILE_READ_BUILD
+		if (reader.remaining_bits() < byte_width && file_in != nullptr && !reader.terminated) {
+			reader.refill();
+			compressed_data_size = LZWBase::read_into_buffer(compressed_data_buffer, BUFFER_SIZE, file_in);
+			reader.rebind(compressed_data_buffer, compressed_data_size);
+		}
+#endif
+
+		/*
+		If there are not enough bits left for a code, the streaming decompressor moves what is left of the chunk to the reader's accumulator
+		and waits for the next chunk, else the stream was not terminated by the end_of_information code and we are done.
+		*/
+		if (reader.remaining_bits() < byte_width) {
+			if (!input_finished && !reader.terminated) {
+				reader.refill();
+				return LZW_NEED_INPUT;
+			}
+			finished = true;
+			return LZW_DONE;
+		}
 
-	while (compressed_data_pointer < compressed_data_size) {
 		/*
 		icode is the LZW code that is just a pointer to the location in the dictionary that it represents.
 		*/
@@ -204,50 +352,307 @@ void LZWDecompress::decompress()
 		Since switches requires to use a constant value, we have to use if/else-if statements.	
 		*/
 		if (icode == clear_code) {
-			
+			if (stop_clears > 0 && --stop_clears == 0) {
+				finished = true;
+				return LZW_DONE;
+			}
+
 			/*
 			If encoder sends random clear code, we must be able to process them
+			The default elements are never changed, so instead of clearing the dictionary and pushing them again we just drop the codes after them.
 			*/
-			byte_width = this->default_byte_width;
-			dictionary->clear();
-			LZWBase::push_default_elements(dictionary);
-			step_byte_width(dictionary, &byte_width);
+			byte_width = (char)start_width;
+			dictionary->truncate((1 << start_width) + 2);
+			if (dictionary->list_size() >= (((ulong64)1) << byte_width) && byte_width < max_width)
+				++byte_width;
 			can_push = false;
 		}
-		else if (icode == end_of_information) // End of information must be the last code in the LZW Stream.
-			return;
+		else if (icode == end_of_information) { // End of information must be the last code in the LZW Stream.
+			finished = true;
+			return LZW_DONE;
+		}
+		else if (icode > dictionary->list_size()
+			|| (icode == dictionary->list_size() && (!can_push || icode >= (((ulong64)1) << max_width)))) {
+			/*
+			A code can only be one we have, or the one we are just adding, anything else is a broken stream and we stop there
+			instead of reading past the dictionary, which matters once the streams come from GIF files we know nothing about.
+			The codes of a stream we read wider than it was written(a max_width above the compressor's) are mostly such codes too, so it is an error and not the end.
+			*/
+			finished =
+				bad_code = true;
+			return LZW_BAD_CODE;
+		}
 		else {
-			read_compressed_stream(icode);
-			step_byte_width(dictionary, &byte_width);
+			read_compressed_stream<StartWidth, MaxWidth>(icode);
+			if (dictionary->list_size() >= (((ulong64)1) << byte_width) && byte_width < max_width)
+				++byte_width;
 		}
+	}
+}
 
-		/*
-		We have to do additional processing, if we are reading from files, just for the fact that the code can span over multiple bytes
-		and we have to address this issue and move the memory accordingly, we cannot wait till all of the buffer is finished and the program starts
-		reading random garbage values, we have a threshold of 32, so when 32 bytes in original buffer are left, we refill the buffer with fresh data.
-		*/
-#ifdef FILE_READ_BUILD
-#define LONG_SIZE 32
-
-		if (compressed_data_pointer >= (compressed_data_size - LONG_SIZE)
-			&& (compressed_data_size - ((byte_width / 8) + ((byte_width % 8) > 0)) - 1) <= compressed_data_pointer) 
-		{
-			int min_byte = (compressed_data_size - compressed_data_pointer);
-			::memcpy(compressed_data_buffer, compressed_data_buffer + compressed_data_pointer,
-				min_byte);
-			
-			compressed_data_size = LZWBase::read_into_buffer(
-				(unsigned char*)(compressed_data_buffer + min_byte),
-				BUFFER_SIZE - min_byte,
-				file_in) + min_byte;
-			compressed_data_pointer = 0;
-			if (compressed_data_size == 0
-				|| (compressed_data_size == min_byte
-					&& (((bit_pointer + byte_width) / this->default_byte_width)
-						+ ((bit_pointer + byte_width) % this->default_byte_width > 0)) > min_byte)) break;
+/*
+The dispatcher of the decode_codes instances, the same as LZWCompress::compress_engine: every minimum code size GIF allows has an instance of its own
+for codes up to GIF_MAX_BYTE_LEN bits, and every other configuration runs the instance that reads the widths at run time.
+*/
+int LZWDecompress::decode()
+{
+	if (this->byte_max_width == GIF_MAX_BYTE_LEN) {
+		switch (this->default_byte_width) {
+		case 2: return decode_codes<2, GIF_MAX_BYTE_LEN>();
+		case 3: return decode_codes<3, GIF_MAX_BYTE_LEN>();
+		case 4: return decode_codes<4, GIF_MAX_BYTE_LEN>();
+		case 5: return decode_codes<5, GIF_MAX_BYTE_LEN>();
+		case 6: return decode_codes<6, GIF_MAX_BYTE_LEN>();
+		case 7: return decode_codes<7, GIF_MAX_BYTE_LEN>();
+		case 8: return decode_codes<8, GIF_MAX_BYTE_LEN>();
 		}
-#endif
 	}
+	return decode_codes<0, 0>();
+}
+
+/*
+Decompresses the whole stream into the decompression_buffer, that is allocated and grown as required.
+Returns LZW_DONE, or LZW_BAD_CODE if the stream has a code it cannot have, what was decoded before it is in the decompression_buffer.
+*/
+int LZWDecompress::decompress()
+{
+	if (decompression_buffer == nullptr)
+		decompression_buffer = (char*)lzw_alloc(allocator, decompression_buffer_size);
+
+	output_base = decompression_buffer;
+	output_window = 0;
+	output_end = decompression_buffer_size;
+
+	int status;
+	while ((status = decode()) == LZW_NEED_OUTPUT) {
+		int update_size = decompression_buffer_size << BUFFER_GROW_SIZE;
+		decompression_buffer = (char*)LZWBase::extend_buffer(decompression_buffer, decompression_buffer_pointer, update_size);
+		decompression_buffer_size = update_size;
+
+		output_base = decompression_buffer;
+		output_end = decompression_buffer_size;
+	}
+	return status;
+}
+
+/*
+Decompresses the stream into the output memory given by the user, which is never reallocated, and the bytes written to it are returned in "written".
+If the output is full before the stream is finished it returns LZW_NEED_OUTPUT, and it must be called again with fresh output memory
+and it continues from where it stopped(even in the middle of a string), else it returns LZW_DONE, or LZW_BAD_CODE for a code it cannot have.
+The streaming decompressor returns LZW_NEED_INPUT when it has used up the chunk given to feed(), so the output size bounds the work done by a call.
+*/
+int LZWDecompress::decompress_into(char *output, int output_size, int *written)
+{
+	output_base = output;
+	output_window = decompression_buffer_pointer;
+	output_end = decompression_buffer_pointer + output_size;
+
+	int status = decode();
+	*written = decompression_buffer_pointer - output_window;
+	return status;
+}
+
+/*
+Scans the stream for its clear codes without decoding it, and pushes a point(see lzw_clear_point) to the index for every clear code
+and one more for where the stream ends, that is the same index the compressor keeps with set_index, for the streams that were compressed without one.
+-----------------
+We only need to know how long the string of every code is, so instead of the dictionary we keep the length of the string of each code,
+every new code is one longer than the last code, and the output offset is the sum of the lengths of all the codes read so far.
+The widths step up exactly the way decode() steps them, it is what we need the dictionary size for.
+It must be called before anything is decompressed, and it does not change the decompressor in any way.
+Returns false if the stream is not in memory or it is framed, as the bit offsets are counted in the codes only.
+*/
+bool LZWDecompress::build_index(MyList<lzw_clear_point> *index)
+{
+	if (reader.framed || file_in != nullptr || reader.pointer != 0 || reader.bit_count != 0 || decompression_buffer_pointer != 0)
+		return false;
+
+	const uint clear_code = 1 << this->default_byte_width
+		, end_of_information = (1 << this->default_byte_width) + 1
+		, first_code = (1 << this->default_byte_width) + 2;
+	const ulong64 full = ((ulong64)1) << this->byte_max_width;
+
+	BitReader scan(reader.buffer, reader.size);
+	MyList<int> lengths(allocator);
+	ulong64 size = first_code;
+	uchar width = (uchar)this->default_byte_width;
+	if (size >= (((ulong64)1) << width) && width < this->byte_max_width)
+		++width;
+
+	long long bits = 0
+		, output = 0;
+	int last_length = 0;
+	bool pushing = false;
+	while (true) {
+		lzw_clear_point point = { bits, width, output };
+		if (scan.remaining_bits() < width) {
+			index->push(point);
+			return true;
+		}
+
+		uint code = scan.read(width);
+		bits += width;
+		if (code == clear_code) {
+			index->push(point);
+			lengths.truncate(0);
+			size = first_code;
+			width = (uchar)this->default_byte_width;
+			pushing = false;
+		}
+		else if (code == end_of_information
+			|| code > size
+			|| (code == size && (!pushing || code >= full))) {
+			//The end of the stream, or where the decoder stops as the stream is broken.
+			index->push(point);
+			return true;
+		}
+		else {
+			if (pushing && size < full) {
+				lengths.push(last_length + 1);
+				++size;
+			}
+			pushing = true;
+			last_length = code < clear_code ? 1 : *lengths[code - first_code];
+			output += last_length;
+		}
+		if (size >= (((ulong64)1) << width) && width < this->byte_max_width)
+			++width;
+	}
+}
+
+/*
+Type: Structure
+Explanation: What the tasks of LZWDecompress::decompress_parallel share.
+segments:	the first and the last point of each segment, a segment is decoded from the clear code at its first point, and it ends at its last point,
+			which is "clears" clear codes on(or at the end of the stream for the last segment).
+output:		the whole output, each segment is decoded straight to where its first point says its output begins.
+decoded:	set for the segments that decoded to exactly the bytes the index says they decode to.
+workers:	the decompressor each worker keeps for all the segments it decodes, it is reset for each segment.
+*/
+struct lzw_segment {
+	const lzw_clear_point *begin
+		, *end;
+	int clears;
+	bool last;
+};
+
+struct segment_batch {
+	LZWDecompress *decompress;
+	lzw_segment *segments;
+	char *output;
+	bool *decoded;
+	LZWDecompress **workers;
+};
+
+/*
+A task of decompress_parallel, decodes a segment with the worker's decompressor, which is the streaming one(available in every build configuration)
+given the stream from the byte the clear code of the segment begins in. We read the clear code ourselves at the width the index gives,
+and the decompressor is then in the very state decode() leaves it in after a clear code, so decompress_into() goes on from there
+until it reads the clear code at the last point of the segment.
+The segment is only decoded if it ends exactly where the index says, both in the output and in the stream(the last segment ends either right after
+the end_of_information code, or where the bits run out).
+*/
+void LZWDecompress::decode_segment_task(void *context, int index, int worker)
+{
+	segment_batch *batch = (segment_batch*)context;
+	LZWDecompress *owner = batch->decompress;
+	const lzw_segment *segment = batch->segments + index;
+
+	LZWDecompress *decompress = batch->workers[worker];
+	if (decompress == nullptr) {
+		decompress =
+			batch->workers[worker] = new LZWDecompress(owner->default_byte_width, owner->byte_max_width, owner->allocator);
+	}
+
+	int byte = (int)(segment->begin->bit_offset >> 3)
+		, skip = (int)(segment->begin->bit_offset & 7);
+	decompress->reset(owner->reader.buffer + byte, owner->reader.size - byte, owner->default_byte_width);
+	decompress->finish_input();
+	if (skip > 0)
+		decompress->reader.read((uchar)skip);
+
+	batch->decoded[index] = false;
+	if (decompress->reader.remaining_bits() < segment->begin->width
+		|| decompress->reader.read((uchar)segment->begin->width) != (uint)(1 << owner->default_byte_width))
+		return;
+
+	decompress->stop_clears = segment->clears;
+	int size = (int)(segment->end->output_offset - segment->begin->output_offset)
+		, written = 0
+		, status = decompress->decompress_into(batch->output + segment->begin->output_offset, size, &written);
+	long long read = ((long long)byte << 3) + ((long long)decompress->reader.pointer << 3) - decompress->reader.bit_count
+		, end = segment->end->bit_offset + segment->end->width;
+	batch->decoded[index] = status == LZW_DONE && written == size && (read == end || (segment->last && read == segment->end->bit_offset));
+}
+
+/*
+Decompresses the whole stream into the decompression_buffer the same way as decompress(), but decodes the segments between the clear codes
+in parallel on the threads of the pool, with the side index of the stream(kept by the compressor with set_index, or made with build_index).
+-----------------
+The decoder starts over with an empty dictionary after every clear code, so the strings after a clear code never refer to anything before it,
+and as the index knows how many bytes come before each clear code, every segment can be decoded straight to its place in the output.
+The segments are made of as many clear codes as it takes to have about LZW_SEGMENTS_PER_WORKER segments per thread, as a segment of a single clear code
+is only 4096 codes for the GIF streams.
+An index that does not match the stream is found out as a segment does not begin with a clear code or does not decode to the size the index says,
+we then decompress the stream with decompress() instead, and so we do for the framed streams and the streams that are not in memory.
+Returns the status the same way as decompress().
+*/
+int LZWDecompress::decompress_parallel(ThreadPool *pool, MyList<lzw_clear_point> *index)
+{
+	int count = (int)index->list_size();
+	bool valid = count >= 2 && !reader.framed && file_in == nullptr && input_finished && reader.pointer == 0 && reader.bit_count == 0
+		&& decompression_buffer_pointer == 0 && !finished && (*index)[0]->output_offset == 0
+		&& (*index)[count - 1]->output_offset < INT_MAX;
+	for (int point = 0; valid && point < count; point++) {
+		const lzw_clear_point *at = (*index)[point];
+		valid = at->bit_offset >= 0 && at->bit_offset < ((long long)reader.size << 3) + (point == count - 1 ? 1 : 0)
+			&& at->width > 0 && at->width <= this->byte_max_width && at->width <= 32
+			&& (point == 0 || at->output_offset >= (*index)[point - 1]->output_offset);
+	}
+	if (!valid)
+		return decompress();
+
+	int total = (int)(*index)[count - 1]->output_offset
+		, target = total / (pool->size() * LZW_SEGMENTS_PER_WORKER) + 1
+		, segment_count = 0;
+	lzw_segment *segments = new lzw_segment[count - 1];
+	for (int begin = 0, point = 1; point < count; point++) {
+		if ((*index)[point]->output_offset - (*index)[begin]->output_offset >= target || point == count - 1) {
+			lzw_segment segment = { (*index)[begin], (*index)[point], point - begin, point == count - 1 };
+			segments[segment_count++] = segment;
+			begin = point;
+		}
+	}
+
+	if (decompression_buffer == nullptr || decompression_buffer_size < total) {
+		lzw_free(allocator, decompression_buffer);
+		decompression_buffer_size = total > BUFFER_SIZE ? total : BUFFER_SIZE;
+		decompression_buffer = (char*)lzw_alloc(allocator, decompression_buffer_size);
+	}
+
+	bool *decoded = new bool[segment_count];
+	LZWDecompress **workers = new LZWDecompress*[pool->size()];
+	for (int worker = 0; worker < pool->size(); worker++)
+		workers[worker] = nullptr;
+
+	segment_batch batch = { this, segments, decompression_buffer, decoded, workers };
+	pool->run(segment_count, decode_segment_task, &batch);
+
+	bool all = true;
+	for (int segment = 0; segment < segment_count; segment++)
+		all = all && decoded[segment];
+
+	for (int worker = 0; worker < pool->size(); worker++)
+		delete workers[worker];
+	delete[] workers;
+	delete[] decoded;
+	delete[] segments;
+
+	if (!all)
+		return decompress();
+	decompression_buffer_pointer = total;
+	finished = true;
+	return LZW_DONE;
 }
 
 /*
@@ -0,0 +1,170 @@
+/*
+    GIFLZWLib --
+    This library provides LZW compression and decompression routine for GIF stream compression.
+
+    Author: Arshdeep Singh, copyleft 2017.
+    LZW algorithm was originally created by Abraham Lempel, Jacob Ziv, and Terry Welch.
+
+    Please see "LICENCE" to read the GPL.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "../Headers/ThreadPool.h"
+
+/*
+Constructor: starts the workers, thread_count of 0 uses one thread per core.
+*/
+ThreadPool::ThreadPool(int thread_count)
+{
+	if (thread_count <= 0)
+		thread_count = (int)std::thread::hardware_concurrency();
+	this->thread_count = thread_count > 0 ? thread_count : 1;
+
+	queues = new pool_queue[this->thread_count];
+	threads = new std::thread[this->thread_count - 1];
+	for (int worker = 1; worker < this->thread_count; worker++)
+		threads[worker - 1] = std::thread(&ThreadPool::worker_loop, this, worker);
+}
+
+/*
+Stops the workers, they are all waiting for a batch as run() only returns once its batch is done.
+*/
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(batch_lock);
+		stopping = true;
+	}
+	batch_ready.notify_all();
+
+	for (int worker = 1; worker < thread_count; worker++)
+		threads[worker - 1].join();
+	delete[] threads;
+	delete[] queues;
+}
+
+/*
+Finds the next task for the worker, returns false once there are no tasks left in any of the queues.
+-----------------
+The worker takes the first task of its own range, and when its range is empty it looks at the other workers in turn
+and steals the second half of the first range it finds that has any tasks, so a worker with slow tasks hands off the tasks it has not begun.
+The stolen range becomes the thief's own range, so it can be stolen from again.
+*/
+bool ThreadPool::next_task(int worker, int *index)
+{
+	pool_queue *own = queues + worker;
+	{
+		std::lock_guard<std::mutex> guard(own->lock);
+		if (own->begin < own->end) {
+			*index = own->begin++;
+			return true;
+		}
+	}
+
+	for (int step = 1; step < thread_count; step++) {
+		pool_queue *victim = queues + (worker + step) % thread_count;
+		int begin, end;
+		{
+			std::lock_guard<std::mutex> guard(victim->lock);
+			if (victim->begin >= victim->end)
+				continue;
+			end = victim->end;
+			begin = victim->begin + ((victim->end - victim->begin) >> 1);
+			victim->end = begin;
+		}
+
+		std::lock_guard<std::mutex> guard(own->lock);
+		*index = begin;
+		own->begin = begin + 1;
+		own->end = end;
+		return true;
+	}
+	return false;
+}
+
+/*
+Runs the tasks of the current batch until there are none left.
+*/
+void ThreadPool::work(int worker)
+{
+	int index;
+	while (next_task(worker, &index))
+		task(context, index, worker);
+}
+
+/*
+The loop of each of our threads, it waits for a new batch, works on it and tells run() when it has no more tasks.
+*/
+void ThreadPool::worker_loop(int worker)
+{
+	unsigned int seen = 0;
+	std::unique_lock<std::mutex> guard(batch_lock);
+	while (true) {
+		batch_ready.wait(guard, [&] { return stopping || generation != seen; });
+		if (stopping)
+			return;
+		seen = generation;
+
+		guard.unlock();
+		work(worker);
+		guard.lock();
+
+		if (--working == 0)
+			batch_done.notify_all();
+	}
+}
+
+/*
+Runs task(context, index, worker) for every index from 0 to task_count and returns once all of them are done.
+-----------------
+The indices are split into one contiguous range per worker, so each worker begins with its share of the tasks in order,
+and the workers that finish early steal from the ones that are behind.
+The calling thread works on the batch too, and a batch is run at a time, so run() can be called from many threads.
+*/
+void ThreadPool::run(int task_count, pool_task task, void *context)
+{
+	if (task_count <= 0)
+		return;
+
+	std::lock_guard<std::mutex> serial(run_lock);
+	if (thread_count == 1) {
+		for (int index = 0; index < task_count; index++)
+			task(context, index, 0);
+		return;
+	}
+
+	for (int worker = 0; worker < thread_count; worker++) {
+		std::lock_guard<std::mutex> guard(queues[worker].lock);
+		queues[worker].begin = (int)(((long long)task_count * worker) / thread_count);
+		queues[worker].end = (int)(((long long)task_count * (worker + 1)) / thread_count);
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(batch_lock);
+		this->task = task;
+		this->context = context;
+		working = thread_count;
+		++generation;
+	}
+	batch_ready.notify_all();
+
+	work(0);
+
+	std::unique_lock<std::mutex> guard(batch_lock);
+	if (--working == 0)
+		return;
+	batch_done.wait(guard, [&] { return working == 0; });
+}
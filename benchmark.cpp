@@ -0,0 +1,1207 @@
+/*
+This file does not use any licence file, but the author disclaims any interest in this file. This file is distributed without any WARRANTY written or implied, even the implied warranty of MERCHANTIBILITY or FITNESS FOR A PARTICULAR PURPOSE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include "./Headers/BitStream.h"
+#include "./Headers/LZWCompress.h"
+#include "./Headers/LZWDecompress.h"
+#include "./Headers/GIFContainer.h"
+
+/*
+Number of codes every benchmark writes, and the number of times it repeats the run, we report the best of all runs.
+*/
+#define BENCH_CODES (1 << 22)
+#define BENCH_RUNS 5
+
+/*
+Size of the synthetic images the compressor benchmarks use, 2048x2048 pixels with one byte(palette index) per pixel.
+*/
+#define BENCH_IMAGE_SIZE (1 << 22)
+
+/*
+The animation the frame-parallel benchmarks use, BENCH_FRAMES frames of 320x240 pixels.
+*/
+#define BENCH_FRAMES 200
+#define BENCH_FRAME_WIDTH 320
+#define BENCH_FRAME_HEIGHT 240
+
+/*
+The icons the small frame benchmark uses, BENCH_ICONS icons of 32x32 pixels with 16 colors.
+*/
+#define BENCH_ICONS 20000
+#define BENCH_ICON_SIZE (32 * 32)
+#define BENCH_ICON_WIDTH 4
+
+/*
+Returns the time in milliseconds since some arbitrary point, only useful for differences.
+*/
+double now_ms(){
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+The writer as it used to be in LZWCompress::write_multibyte_buffer, kept here so we can compare the BitWriter against it.
+It has been moved out of the class as is, with the class members turned into a small struct.
+*/
+struct legacy_writer {
+	unsigned char *compression_buffer;
+	int compression_buffer_size
+		, compression_buffer_pointer;
+	unsigned char bit_pointer;
+
+	void write(unsigned int information, unsigned char byte_width){
+		char iteration_a = (this->bit_pointer + byte_width)
+			, iteration_b = (iteration_a >> 3) + ((iteration_a & 0x7) > 0)
+			, bits_written = 0;
+
+		static char i = 0, j = 0;
+		for (i = 0, j = iteration_b - 1; i < iteration_b; ++i) {
+			char put_here = (8 - this->bit_pointer), leaf;
+			if (i == j) {
+				char size = (byte_width - bits_written)
+					, lshift = bits_written - this->bit_pointer;
+				leaf = (char)(information >> lshift);
+				bits_written += size;
+				this->bit_pointer += size;
+			}
+			else {
+				bits_written += put_here;
+				char shift = 8 - (bits_written);
+				leaf = (char)(shift & 0x80
+					? information >> -shift
+					: information << shift);
+				this->bit_pointer += put_here;
+			}
+			*(this->compression_buffer + this->compression_buffer_pointer) |= leaf;
+			if (this->bit_pointer >> 3) {
+				++(this->compression_buffer_pointer);
+				this->bit_pointer &= 0x7;
+			}
+			int next_pointer = this->compression_buffer_pointer;
+			if (next_pointer == (this->compression_buffer_size - 1)) {
+				int new_size = compression_buffer_size << ((compression_buffer_size < (1 << 18)) ? 2 : 1);
+				compression_buffer = (unsigned char*)::realloc(compression_buffer, new_size);
+				::memset(compression_buffer + compression_buffer_size, 0, new_size - compression_buffer_size);
+				compression_buffer_size = new_size;
+			}
+		}
+	}
+};
+
+/*
+Reads back the codes from a least significant bit first stream one bit at a time, returns true if they match the written codes.
+*/
+bool verify_codes(const unsigned char *stream, int size, const unsigned int *codes, int count, int width){
+	long long bit = 0;
+	for (int i = 0; i < count; i++) {
+		unsigned int code = 0;
+		for (int b = 0; b < width; b++, bit++) {
+			if ((bit >> 3) >= size) return false;
+			code |= ((stream[bit >> 3] >> (bit & 7)) & 1u) << b;
+		}
+		if (code != codes[i]) return false;
+	}
+	return true;
+}
+
+/*
+Compares the legacy per byte writer against the BitWriter at code widths 3-12, and checks that the BitWriter's output reads back.
+We don't compare the two outputs byte by byte because the legacy writer shifts by a negative amount when a code fits in the
+byte it started in, so it never produced a valid stream for widths below 8.
+*/
+void bench_writer(){
+	unsigned int *codes = (unsigned int*)::malloc(BENCH_CODES * sizeof(unsigned int));
+	printf("%-6s %-14s %-14s %-8s\n", "width", "legacy(MB/s)", "bitwriter(MB/s)", "speedup");
+
+	for (int width = 3; width <= 12; width++) {
+		srand(width);
+		for (int i = 0; i < BENCH_CODES; i++) codes[i] = (unsigned int)rand() & ((1u << width) - 1);
+
+		double legacy_best = 1e30, writer_best = 1e30;
+		int writer_size = 0;
+		unsigned char *legacy_out = nullptr, *writer_out = nullptr;
+
+		for (int run = 0; run < BENCH_RUNS; run++) {
+			::free(legacy_out);
+			::free(writer_out);
+
+			legacy_writer legacy = { (unsigned char*)::calloc(4096, 1), 4096, 0, 0 };
+			double begin = now_ms();
+			for (int i = 0; i < BENCH_CODES; i++) legacy.write(codes[i], (unsigned char)width);
+			double end = now_ms();
+			legacy_best = end - begin < legacy_best ? end - begin : legacy_best;
+			legacy_out = legacy.compression_buffer;
+
+			BitWriter writer(4096);
+			begin = now_ms();
+			for (int i = 0; i < BENCH_CODES; i++) writer.write(codes[i], (unsigned char)width);
+			writer_size = writer.finish();
+			end = now_ms();
+			writer_best = end - begin < writer_best ? end - begin : writer_best;
+			writer_out = writer.buffer;
+		}
+
+		double megabytes = (double)BENCH_CODES * width / 8 / (1 << 20);
+		printf("%-6d %-14.1f %-14.1f %-8.2f%s\n", width
+			, megabytes / (legacy_best / 1000)
+			, megabytes / (writer_best / 1000)
+			, legacy_best / writer_best
+			, verify_codes(writer_out, writer_size, codes, BENCH_CODES, width) ? "" : "  MISMATCH");
+
+		::free(legacy_out);
+		::free(writer_out);
+	}
+
+	::free(codes);
+}
+
+/*
+Fills the buffer with something that looks like a dithered photograph, the palette index drifts slowly with some noise on every pixel.
+*/
+void make_photographic(unsigned char *image, int size){
+	srand(1);
+	int value = 128;
+	for (int i = 0; i < size; i++) {
+		value += (rand() % 7) - 3;
+		value = value < 0 ? 0 : (value > 255 ? 255 : value);
+		image[i] = (unsigned char)(value ^ (rand() & 3));
+	}
+}
+
+/*
+Fills the buffer with something that looks like a screenshot or a flat color illustration, long runs of a handful of colors.
+*/
+void make_flat(unsigned char *image, int size){
+	srand(2);
+	for (int i = 0; i < size;) {
+		int run = 1 + rand() % 400;
+		unsigned char color = (unsigned char)(rand() % 16);
+		while (run-- && i < size) image[i++] = color;
+	}
+}
+
+/*
+Compresses the image with the given engine BENCH_RUNS times, and prints the best time.
+*/
+void bench_engine(const char *name, const char *input, unsigned char *image, int size, int engine){
+	double best = 1e30;
+	int compressed_size = 0;
+	for (int run = 0; run < BENCH_RUNS; run++) {
+		double begin = now_ms();
+		LZWCompress lzw(image, size, DEFAULT_BYTE_LEN, engine);
+		compressed_size = lzw.compress();
+		double end = now_ms();
+		best = end - begin < best ? end - begin : best;
+		int ignored;
+		::free(lzw.acquire_buffer(&ignored));
+	}
+	printf("%-14s %-14s %-10.2f %-12.1f %d\n", input, name, best, (size / (double)(1 << 20)) / (best / 1000), compressed_size);
+}
+
+/*
+Compresses the image as a sequence of frames of frame_size bytes, each frame with its own LZWCompress as an animated GIF encoder would.
+*/
+void bench_frames(const char *name, const char *input, unsigned char *image, int size, int frame_size, int engine){
+	double best = 1e30;
+	int compressed_size = 0;
+	for (int run = 0; run < BENCH_RUNS; run++) {
+		compressed_size = 0;
+		double begin = now_ms();
+		for (int frame = 0; frame + frame_size <= size; frame += frame_size) {
+			LZWCompress lzw(image + frame, frame_size, DEFAULT_BYTE_LEN, engine);
+			compressed_size += lzw.compress();
+			int ignored;
+			::free(lzw.acquire_buffer(&ignored));
+		}
+		double end = now_ms();
+		best = end - begin < best ? end - begin : best;
+	}
+	printf("%-14s %-14s %-10.2f %-12.1f %d\n", input, name, best, (size / (double)(1 << 20)) / (best / 1000), compressed_size);
+}
+
+/*
+Compares the dictionary engines on photographic and flat color inputs, and on a sequence of 320x240 animation frames.
+The HashTable's codes grow up to MAX_BYTE_LEN bits while the other engines stop at GIF_MAX_BYTE_LEN bits, so the compressed sizes differ too.
+*/
+void bench_dictionary(){
+	unsigned char *image = (unsigned char*)::malloc(BENCH_IMAGE_SIZE);
+	const char *names[] = { "HashTable", "CompactTable", "ChildTable" };
+	const int engines[] = { HASH_TABLE_ENGINE, COMPACT_TABLE_ENGINE, CHILD_TABLE_ENGINE };
+	printf("%-14s %-14s %-10s %-12s %s\n", "input", "engine", "ms", "MB/s", "compressed");
+
+	make_photographic(image, BENCH_IMAGE_SIZE);
+	for (int i = 0; i < 3; i++)
+		bench_engine(names[i], "photographic", image, BENCH_IMAGE_SIZE, engines[i]);
+
+	make_flat(image, BENCH_IMAGE_SIZE);
+	for (int i = 0; i < 3; i++)
+		bench_engine(names[i], "flat-color", image, BENCH_IMAGE_SIZE, engines[i]);
+
+	/*
+	Half of each frame is flat and half is photographic, like a sprite moving over a background.
+	*/
+	make_photographic(image, BENCH_IMAGE_SIZE / 2);
+	make_flat(image + BENCH_IMAGE_SIZE / 2, BENCH_IMAGE_SIZE / 2);
+	for (int frame = 0; frame < BENCH_IMAGE_SIZE / 2; frame += 320 * 120)
+		::memcpy(image + frame, image + BENCH_IMAGE_SIZE / 2 + frame, 320 * 60);
+	for (int i = 0; i < 3; i++)
+		bench_frames(names[i], "frames", image, BENCH_IMAGE_SIZE, 320 * 240, engines[i]);
+
+	::free(image);
+}
+
+/*
+Fills a HashTable of 2^19 slots just below HASH_FILL, and then compares the probes on lookups of which half are misses.
+All the probes must find the very same codes, otherwise we report a mismatch.
+*/
+void bench_probe(){
+	const int table_size = 1 << 19
+		, lookups = 1 << 22;
+	const char *names[] = { "scalar", "sse2", "avx2" };
+
+	HashTable table(table_size, 8);
+	const int elements = (int)(table_size * HASH_FILL) - (int)table.size() - 16;
+	srand(3);
+	for (int i = 0; i < elements; i++)
+		table.add((char)(i & 0xff), i >> 8, i);
+
+	int *previous_codes = (int*)::malloc(lookups * sizeof(int))
+		, *expected = (int*)::malloc(lookups * sizeof(int));
+	char *characters = (char*)::malloc(lookups);
+	for (int i = 0; i < lookups; i++) {
+		int key = rand() % (elements * 2);
+		characters[i] = (char)(key & 0xff);
+		previous_codes[i] = key >> 8;
+	}
+
+	printf("%-8s %-10s %-14s\n", "probe", "ms", "Mlookups/s");
+	for (int level = HASH_PROBE_SCALAR; level <= HASH_PROBE_AVX2; level++) {
+		if (table.select_probe(level) != level) {
+			printf("%-8s not supported by this CPU\n", names[level]);
+			continue;
+		}
+
+		double best = 1e30;
+		bool same = true;
+		for (int run = 0; run < BENCH_RUNS; run++) {
+			double begin = now_ms();
+			long long checksum = 0;
+			for (int i = 0; i < lookups; i++) {
+				int code = table.find(characters[i], previous_codes[i]);
+				if (level == HASH_PROBE_SCALAR) expected[i] = code;
+				else same = same && expected[i] == code;
+				checksum += code;
+			}
+			double end = now_ms();
+			best = end - begin < best ? end - begin : best;
+			if (checksum == 1) puts("");
+		}
+		printf("%-8s %-10.2f %-14.1f%s\n", names[level], best, lookups / (best * 1000), same ? "" : "  MISMATCH");
+	}
+
+	::free(previous_codes);
+	::free(expected);
+	::free(characters);
+}
+
+/*
+Adds strings to a HashTable that starts small, in batches of 1024 adds(each one after a find as the compressor does),
+and prints the median, the 99th percentile and the slowest batch, the slow batches are the ones where the table expands.
+*/
+void bench_rehash(){
+	const int batch = 1 << 10
+		, batches = 1 << 12;
+	double *times = (double*)::malloc(batches * sizeof(double));
+
+	HashTable table(1 << 10, 8);
+	long long checksum = 0;
+	int code = 0;
+	for (int i = 0; i < batches; i++) {
+		double begin = now_ms();
+		for (int j = 0; j < batch; j++, code++) {
+			checksum += table.find((char)(code & 0xff), code >> 8);
+			table.add((char)(code & 0xff), code >> 8, code);
+		}
+		times[i] = now_ms() - begin;
+	}
+	if (checksum == 1) puts("");
+
+	std::sort(times, times + batches);
+	printf("%-10s %-10s %-10s %-10s\n", "adds", "p50(us)", "p99(us)", "max(us)");
+	printf("%-10d %-10.1f %-10.1f %-10.1f\n", batch * batches
+		, times[batches / 2] * 1000, times[batches - batches / 100] * 1000, times[batches - 1] * 1000);
+	::free(times);
+}
+
+/*
+Fills a HashTable of the default size with a GIF sized dictionary and clears it, over and over, the way a stream with a clear code every
+4096 codes does, and then decodes a stream that has a clear code every 4096 codes, as the decoder resets its dictionary for each one too.
+*/
+void bench_clear(){
+	const int rounds = 1 << 12
+		, strings = (1 << GIF_MAX_BYTE_LEN) - 258;
+
+	HashTable table(1 << 19, 8);
+	double best = 1e30;
+	for (int run = 0; run < BENCH_RUNS; run++) {
+		long long checksum = 0;
+		double begin = now_ms();
+		for (int round = 0; round < rounds; round++) {
+			for (int i = 0; i < strings; i++) {
+				checksum += table.find((char)(i * 7 + round), i + 257);
+				table.add((char)(i * 7 + round), i + 257, i + 258);
+			}
+			table.clear();
+		}
+		double end = now_ms();
+		best = end - begin < best ? end - begin : best;
+		if (checksum == 1) puts("");
+	}
+	printf("%-10s %-10s %-10s %-14s\n", "dictionary", "clears", "ms", "us/dictionary");
+	printf("%-10s %-10d %-10.2f %-14.2f\n", "hash", rounds, best, best * 1000 / rounds);
+
+	unsigned char *image = (unsigned char*)::malloc(BENCH_IMAGE_SIZE);
+	for (int i = 0; i < BENCH_IMAGE_SIZE; i++) image[i] = (unsigned char)rand();
+	LZWCompress lzw(image, BENCH_IMAGE_SIZE, 8, COMPACT_TABLE_ENGINE);
+	lzw.compress();
+	int compressed_size = 0, size = 0;
+	unsigned char *compressed = lzw.acquire_buffer(&compressed_size);
+
+	best = 1e30;
+	for (int run = 0; run < BENCH_RUNS; run++) {
+		double begin = now_ms();
+		LZWDecompress decoder(compressed, compressed_size, 8, GIF_MAX_BYTE_LEN);
+		decoder.decompress();
+		char *decompressed = decoder.acquire_buffer(&size);
+		double end = now_ms();
+		best = end - begin < best ? end - begin : best;
+		if (size != BENCH_IMAGE_SIZE || ::memcmp(decompressed, image, size) != 0) puts("MISMATCH");
+		::free(decompressed);
+	}
+	printf("%-10s %-10d %-10.2f %-14.2f\n", "decode", BENCH_IMAGE_SIZE / strings, best, best * 1000 / (BENCH_IMAGE_SIZE / strings));
+
+	::free(compressed);
+	::free(image);
+}
+
+/*
+Compresses each frame_size frame of the image as a GIF stream(12 bit codes), and then decodes all the frames BENCH_RUNS times and prints the best time.
+*/
+void bench_decode_frames(const char *input, unsigned char *image, int size, int frame_size){
+	int frames = size / frame_size
+		, compressed_size = 0;
+	unsigned char **streams = (unsigned char**)::malloc(frames * sizeof(unsigned char*));
+	int *stream_sizes = (int*)::malloc(frames * sizeof(int));
+	for (int frame = 0; frame < frames; frame++) {
+		LZWCompress lzw(image + frame * frame_size, frame_size, DEFAULT_BYTE_LEN, COMPACT_TABLE_ENGINE);
+		lzw.compress();
+		streams[frame] = lzw.acquire_buffer(stream_sizes + frame);
+		compressed_size += stream_sizes[frame];
+	}
+
+	double best = 1e30;
+	bool same = true;
+	for (int run = 0; run < BENCH_RUNS; run++) {
+		double begin = now_ms();
+		for (int frame = 0; frame < frames; frame++) {
+			LZWDecompress decoder(streams[frame], stream_sizes[frame], DEFAULT_BYTE_LEN, GIF_MAX_BYTE_LEN);
+			decoder.decompress();
+			int decoded_size = 0;
+			char *decoded = decoder.acquire_buffer(&decoded_size);
+			same = same && decoded_size == frame_size && ::memcmp(decoded, image + frame * frame_size, frame_size) == 0;
+			::free(decoded);
+		}
+		double end = now_ms();
+		best = end - begin < best ? end - begin : best;
+	}
+	printf("%-14s %-10d %-10.2f %-12.1f %d%s\n", input, frames, best, (frames * frame_size / (double)(1 << 20)) / (best / 1000), compressed_size, same ? "" : "  MISMATCH");
+
+	for (int frame = 0; frame < frames; frame++)
+		::free(streams[frame]);
+	::free(streams);
+	::free(stream_sizes);
+}
+
+/*
+Decoder throughput(in decoded bytes) on the same inputs as the dictionary benchmark, as there are no GIF files in the repository.
+*/
+void bench_decode(){
+	unsigned char *image = (unsigned char*)::malloc(BENCH_IMAGE_SIZE);
+	printf("%-14s %-10s %-10s %-12s %s\n", "input", "frames", "ms", "MB/s", "compressed");
+
+	make_photographic(image, BENCH_IMAGE_SIZE);
+	bench_decode_frames("photographic", image, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+
+	make_flat(image, BENCH_IMAGE_SIZE);
+	bench_decode_frames("flat-color", image, BENCH_IMAGE_SIZE, BENCH_IMAGE_SIZE);
+
+	make_photographic(image, BENCH_IMAGE_SIZE / 2);
+	make_flat(image + BENCH_IMAGE_SIZE / 2, BENCH_IMAGE_SIZE / 2);
+	for (int frame = 0; frame < BENCH_IMAGE_SIZE / 2; frame += 320 * 120)
+		::memcpy(image + frame, image + BENCH_IMAGE_SIZE / 2 + frame, 320 * 60);
+	bench_decode_frames("frames", image, BENCH_IMAGE_SIZE, 320 * 240);
+
+	::free(image);
+}
+
+/*
+Fills "frames" with BENCH_FRAMES frames, cut from the photographic and the flat color inputs so they compress differently,
+and "description" with the description all of them share.
+*/
+void make_frames(unsigned char *frames, gif_frame *description){
+	const int frame_size = BENCH_FRAME_WIDTH * BENCH_FRAME_HEIGHT;
+	unsigned char *image = (unsigned char*)::malloc(BENCH_IMAGE_SIZE);
+	make_photographic(image, BENCH_IMAGE_SIZE / 2);
+	make_flat(image + BENCH_IMAGE_SIZE / 2, BENCH_IMAGE_SIZE / 2);
+	for (int i = 0; i < BENCH_FRAMES; i++) {
+		int offset = (int)(((long long)i * 7919 * frame_size) % (BENCH_IMAGE_SIZE - frame_size));
+		::memcpy(frames + (long long)i * frame_size, image + offset, frame_size);
+	}
+	::free(image);
+
+	::memset(description, 0, sizeof(gif_frame));
+	description->width = BENCH_FRAME_WIDTH;
+	description->height = BENCH_FRAME_HEIGHT;
+	description->delay = 4;
+	description->transparent_index = -1;
+}
+
+/*
+Fills the palette with 256 shades of gray.
+*/
+void make_palette(unsigned char *palette){
+	for (int color = 0; color < 3 * 256; color++) palette[color] = (unsigned char)(color / 3);
+}
+
+/*
+Writes a BENCH_FRAMES frame animated GIF, the frame pixels are kept in "frames" to check the decoded frames against.
+*/
+unsigned char *make_animation(unsigned char *frames, int *gif_size){
+	const int frame_size = BENCH_FRAME_WIDTH * BENCH_FRAME_HEIGHT;
+	gif_frame frame;
+	make_frames(frames, &frame);
+
+	unsigned char palette[3 * 256];
+	make_palette(palette);
+	GIFWriter writer(BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT, palette, 256, 0);
+	for (int i = 0; i < BENCH_FRAMES; i++)
+		writer.add_frame(frames + (long long)i * frame_size, &frame);
+	writer.finish();
+	return writer.acquire_buffer(gif_size);
+}
+
+/*
+Decodes the animation with GIFReader::decode_frames on pools of 1 thread up to one thread per core(at least 4 threads), and prints the speedup over 1 thread.
+*/
+void bench_parallel_decode(){
+	const int frame_size = BENCH_FRAME_WIDTH * BENCH_FRAME_HEIGHT;
+	unsigned char *frames = (unsigned char*)::malloc((long long)BENCH_FRAMES * frame_size)
+		, *decoded = (unsigned char*)::malloc((long long)BENCH_FRAMES * frame_size);
+	int gif_size = 0;
+	unsigned char *gif = make_animation(frames, &gif_size);
+
+	unsigned char *pixels[BENCH_FRAMES];
+	int pixels_sizes[BENCH_FRAMES];
+	for (int i = 0; i < BENCH_FRAMES; i++) {
+		pixels[i] = decoded + (long long)i * frame_size;
+		pixels_sizes[i] = frame_size;
+	}
+
+	int cores = (int)std::thread::hardware_concurrency()
+		, most = cores > 4 ? cores : 4;
+	printf("%d frames of %dx%d, %d bytes, %d cores\n", BENCH_FRAMES, BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT, gif_size, cores);
+	printf("%-10s %-10s %-12s %s\n", "threads", "ms", "MB/s", "speedup");
+
+	double single = 0;
+	for (int threads = 1; threads <= most; threads <<= 1) {
+		ThreadPool pool(threads);
+		double best = 1e30;
+		bool same = true;
+		for (int run = 0; run < BENCH_RUNS; run++) {
+			::memset(decoded, 0, (long long)BENCH_FRAMES * frame_size);
+			GIFReader reader(gif, gif_size);
+			double begin = now_ms();
+			same = reader.decode_frames(&pool, pixels, pixels_sizes) && same;
+			double end = now_ms();
+			best = end - begin < best ? end - begin : best;
+			same = same && ::memcmp(decoded, frames, (long long)BENCH_FRAMES * frame_size) == 0;
+		}
+		if (threads == 1) single = best;
+		printf("%-10d %-10.2f %-12.1f %.2fx%s\n", threads, best, ((long long)BENCH_FRAMES * frame_size / (double)(1 << 20)) / (best / 1000), single / best, same ? "" : "  MISMATCH");
+	}
+
+	::free(gif);
+	::free(frames);
+	::free(decoded);
+}
+
+/*
+Encodes the animation one frame at a time with add_frame(a new compressor per frame), and then with add_frames on pools of 1 thread
+up to one thread per core(at least 4 threads), and prints the speedup over add_frame. All of them must write the same GIF.
+*/
+void bench_parallel_encode(){
+	const int frame_size = BENCH_FRAME_WIDTH * BENCH_FRAME_HEIGHT;
+	unsigned char *frames = (unsigned char*)::malloc((long long)BENCH_FRAMES * frame_size);
+	gif_frame frame;
+	make_frames(frames, &frame);
+
+	unsigned char palette[3 * 256];
+	make_palette(palette);
+	const unsigned char *pixels[BENCH_FRAMES];
+	gif_frame descriptions[BENCH_FRAMES];
+	for (int i = 0; i < BENCH_FRAMES; i++) {
+		pixels[i] = frames + (long long)i * frame_size;
+		descriptions[i] = frame;
+	}
+
+	int cores = (int)std::thread::hardware_concurrency()
+		, most = cores > 4 ? cores : 4;
+	printf("%d frames of %dx%d, %d cores\n", BENCH_FRAMES, BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT, cores);
+	printf("%-12s %-10s %-12s %-10s %s\n", "threads", "ms", "MB/s", "speedup", "size");
+
+	double single = 1e30;
+	int reference_size = 0;
+	unsigned char *reference = nullptr;
+	for (int run = 0; run < BENCH_RUNS; run++) {
+		double begin = now_ms();
+		GIFWriter writer(BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT, palette, 256, 0);
+		for (int i = 0; i < BENCH_FRAMES; i++)
+			writer.add_frame(pixels[i], &frame);
+		writer.finish();
+		double end = now_ms();
+		single = end - begin < single ? end - begin : single;
+		::free(reference);
+		reference = writer.acquire_buffer(&reference_size);
+	}
+	printf("%-12s %-10.2f %-12.1f %-10s %d\n", "add_frame", single, ((long long)BENCH_FRAMES * frame_size / (double)(1 << 20)) / (single / 1000), "1.00x", reference_size);
+
+	for (int threads = 1; threads <= most; threads <<= 1) {
+		ThreadPool pool(threads);
+		double best = 1e30;
+		bool same = true;
+		for (int run = 0; run < BENCH_RUNS; run++) {
+			double begin = now_ms();
+			GIFWriter writer(BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT, palette, 256, 0);
+			writer.add_frames(&pool, pixels, descriptions, BENCH_FRAMES);
+			int size = writer.finish();
+			double end = now_ms();
+			best = end - begin < best ? end - begin : best;
+
+			unsigned char *gif = writer.acquire_buffer(&size);
+			same = same && size == reference_size && ::memcmp(gif, reference, size) == 0;
+			::free(gif);
+		}
+		printf("%-12d %-10.2f %-12.1f %-10.2f %d%s\n", threads, best, ((long long)BENCH_FRAMES * frame_size / (double)(1 << 20)) / (best / 1000), single / best, reference_size, same ? "" : "  MISMATCH");
+	}
+
+	::free(reference);
+	::free(frames);
+}
+
+/*
+Compresses and decompresses every icon(as a stream in sub-blocks) with the given compressor and decompressor,
+or with a new compressor and decompressor of the engine for each icon if they are nullptr. Returns the time taken, and "same" is cleared if an icon does not come back.
+*/
+double code_icons(const unsigned char *icons, unsigned char *stream, int stream_size, unsigned char *decoded, int engine, LZWCompress *compress, LZWDecompress *decompress, bool *same){
+	double begin = now_ms();
+	for (int icon = 0; icon < BENCH_ICONS; icon++) {
+		const unsigned char *pixels = icons + icon * BENCH_ICON_SIZE;
+		int written = 0
+			, decoded_size = 0;
+
+		if (compress != nullptr) {
+			compress->reset(pixels, BENCH_ICON_SIZE, BENCH_ICON_WIDTH);
+			compress->compress_into(stream, stream_size, &written);
+			decompress->reset(stream, written, BENCH_ICON_WIDTH);
+			decompress->decompress_into((char*)decoded, BENCH_ICON_SIZE, &decoded_size);
+		}
+		else {
+			LZWCompress fresh_compress(BENCH_ICON_WIDTH, engine);
+			fresh_compress.set_framing(LZW_FRAMING_SUB_BLOCKS);
+			fresh_compress.reset(pixels, BENCH_ICON_SIZE, BENCH_ICON_WIDTH);
+			fresh_compress.compress_into(stream, stream_size, &written);
+
+			LZWDecompress fresh_decompress(BENCH_ICON_WIDTH, lzw_engine_max_width(engine));
+			fresh_decompress.set_framing(LZW_FRAMING_SUB_BLOCKS);
+			fresh_decompress.feed(stream, written);
+			fresh_decompress.finish_input();
+			fresh_decompress.decompress_into((char*)decoded, BENCH_ICON_SIZE, &decoded_size);
+		}
+		*same = *same && decoded_size == BENCH_ICON_SIZE && ::memcmp(decoded, pixels, BENCH_ICON_SIZE) == 0;
+	}
+	return now_ms() - begin;
+}
+
+/*
+Round trips BENCH_ICONS small icons with each engine, once with a new compressor and decompressor per icon, and once with a single compressor and decompressor
+that are reset for each icon, and prints the best time of each and the time per icon.
+*/
+void bench_small_frames(){
+	unsigned char *icons = (unsigned char*)::malloc(BENCH_ICONS * BENCH_ICON_SIZE)
+		, *decoded = (unsigned char*)::malloc(BENCH_ICON_SIZE);
+	make_photographic(icons, BENCH_ICONS * BENCH_ICON_SIZE);
+	for (int pixel = 0; pixel < BENCH_ICONS * BENCH_ICON_SIZE; pixel++)
+		icons[pixel] &= (1 << BENCH_ICON_WIDTH) - 1;
+
+	int stream_size = (int)LZWCompress::compress_bound(BENCH_ICON_SIZE, BENCH_ICON_WIDTH, HASH_TABLE_ENGINE, LZW_FRAMING_SUB_BLOCKS);
+	unsigned char *stream = (unsigned char*)::malloc(stream_size);
+
+	printf("%-14s %-10s %-10s %-10s %s\n", "engine", "codecs", "icons", "ms", "us/icon");
+	const int engines[2] = { HASH_TABLE_ENGINE, CHILD_TABLE_ENGINE };
+	const char *engine_names[2] = { "hash", "child" }
+		, *names[2] = { "fresh", "reset" };
+	for (int engine = 0; engine < 2; engine++) {
+		LZWCompress compress(BENCH_ICON_WIDTH, engines[engine]);
+		compress.set_framing(LZW_FRAMING_SUB_BLOCKS);
+		LZWDecompress decompress(BENCH_ICON_WIDTH, lzw_engine_max_width(engines[engine]));
+		decompress.set_framing(LZW_FRAMING_SUB_BLOCKS);
+
+		for (int mode = 0; mode < 2; mode++) {
+			double best = 1e30;
+			bool same = true;
+			for (int run = 0; run < BENCH_RUNS; run++)
+				best = std::min(best, code_icons(icons, stream, stream_size, decoded, engines[engine], mode ? &compress : nullptr, mode ? &decompress : nullptr, &same));
+			printf("%-14s %-10s %-10d %-10.2f %.2f%s\n", engine_names[engine], names[mode], BENCH_ICONS, best, best * 1000 / BENCH_ICONS, same ? "" : "  MISMATCH");
+		}
+	}
+
+	::free(stream);
+	::free(decoded);
+	::free(icons);
+}
+
+/*
+Round trips every icon with a new compressor and decompressor whose buffers come from the allocator, like a server that codes one small image per request.
+The arena is released after each icon, as it would be at the end of a request. Returns the time taken, and "same" is cleared if an icon does not come back.
+*/
+double code_icons_from(const unsigned char *icons, unsigned char *stream, int stream_size, unsigned char *decoded, const lzw_allocator *allocator, ArenaAllocator *arena, bool *same){
+	double begin = now_ms();
+	for (int icon = 0; icon < BENCH_ICONS; icon++) {
+		const unsigned char *pixels = icons + icon * BENCH_ICON_SIZE;
+		int written = 0
+			, decoded_size = 0;
+		{
+			LZWCompress compress(BENCH_ICON_WIDTH, CHILD_TABLE_ENGINE, allocator);
+			compress.set_framing(LZW_FRAMING_SUB_BLOCKS);
+			compress.reset(pixels, BENCH_ICON_SIZE, BENCH_ICON_WIDTH);
+			compress.compress_into(stream, stream_size, &written);
+
+			LZWDecompress decompress(BENCH_ICON_WIDTH, GIF_MAX_BYTE_LEN, allocator);
+			decompress.set_framing(LZW_FRAMING_SUB_BLOCKS);
+			decompress.feed(stream, written);
+			decompress.finish_input();
+			decompress.decompress_into((char*)decoded, BENCH_ICON_SIZE, &decoded_size);
+		}
+		if (arena != nullptr)
+			arena->release_all();
+		*same = *same && decoded_size == BENCH_ICON_SIZE && ::memcmp(decoded, pixels, BENCH_ICON_SIZE) == 0;
+	}
+	return now_ms() - begin;
+}
+
+/*
+Round trips BENCH_ICONS small icons with new ChildTable codecs per icon whose buffers come from ::malloc, an ArenaAllocator and a PoolAllocator,
+then encodes BENCH_FRAMES frames with add_frames on one thread per core with each allocator, and prints the best time of each.
+*/
+void bench_allocators(){
+	unsigned char *icons = (unsigned char*)::malloc(BENCH_ICONS * BENCH_ICON_SIZE)
+		, *decoded = (unsigned char*)::malloc(BENCH_ICON_SIZE);
+	make_photographic(icons, BENCH_ICONS * BENCH_ICON_SIZE);
+	for (int pixel = 0; pixel < BENCH_ICONS * BENCH_ICON_SIZE; pixel++)
+		icons[pixel] &= (1 << BENCH_ICON_WIDTH) - 1;
+
+	int stream_size = (int)LZWCompress::compress_bound(BENCH_ICON_SIZE, BENCH_ICON_WIDTH, CHILD_TABLE_ENGINE, LZW_FRAMING_SUB_BLOCKS);
+	unsigned char *stream = (unsigned char*)::malloc(stream_size);
+
+	ArenaAllocator arena;
+	PoolAllocator pool;
+	const lzw_allocator *allocators[3] = { nullptr, arena.allocator(), pool.allocator() };
+	const char *names[3] = { "malloc", "arena", "pool" };
+
+	printf("%-14s %-10s %-10s %s\n", "allocator", "icons", "ms", "us/icon");
+	for (int kind = 0; kind < 3; kind++) {
+		double best = 1e30;
+		bool same = true;
+		for (int run = 0; run < BENCH_RUNS; run++)
+			best = std::min(best, code_icons_from(icons, stream, stream_size, decoded, allocators[kind], kind == 1 ? &arena : nullptr, &same));
+		printf("%-14s %-10d %-10.2f %.2f%s\n", names[kind], BENCH_ICONS, best, best * 1000 / BENCH_ICONS, same ? "" : "  MISMATCH");
+	}
+
+	::free(stream);
+	::free(decoded);
+	::free(icons);
+
+	unsigned char *frames = (unsigned char*)::malloc((size_t)BENCH_FRAMES * BENCH_FRAME_WIDTH * BENCH_FRAME_HEIGHT)
+		, palette[3 * 256];
+	gif_frame frame
+		, descriptions[BENCH_FRAMES];
+	const unsigned char *pixels[BENCH_FRAMES];
+	make_frames(frames, &frame);
+	make_palette(palette);
+	for (int i = 0; i < BENCH_FRAMES; i++) {
+		descriptions[i] = frame;
+		pixels[i] = frames + (size_t)i * BENCH_FRAME_WIDTH * BENCH_FRAME_HEIGHT;
+	}
+
+	ThreadPool threads;
+	printf("\n%d frames of %dx%d on %d threads\n", BENCH_FRAMES, BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT, threads.size());
+	printf("%-14s %-10s %s\n", "allocator", "ms", "size");
+	for (int kind = 0; kind < 3; kind++) {
+		double best = 1e30;
+		int size = 0;
+		for (int run = 0; run < BENCH_RUNS; run++) {
+			double begin = now_ms();
+			{
+				GIFWriter writer(BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT, palette, 256, 0, allocators[kind]);
+				writer.add_frames(&threads, pixels, descriptions, BENCH_FRAMES);
+				writer.finish();
+				lzw_free(allocators[kind], writer.acquire_buffer(&size));
+			}
+			if (kind == 1)
+				arena.release_all();
+			best = std::min(best, now_ms() - begin);
+		}
+		printf("%-14s %-10.2f %d\n", names[kind], best, size);
+	}
+	::free(frames);
+}
+
+/*
+Compresses a BENCH_IMAGE_SIZE image(half photographic and half flat color) with compress() and with compress_parallel on pools of 1 thread up to
+one thread per core(at least 4 threads), and prints the speedup over compress() and how much larger the output of the stripes is.
+*/
+void bench_stripes(){
+	unsigned char *image = (unsigned char*)::malloc(BENCH_IMAGE_SIZE);
+	make_photographic(image, BENCH_IMAGE_SIZE / 2);
+	make_flat(image + BENCH_IMAGE_SIZE / 2, BENCH_IMAGE_SIZE / 2);
+
+	int cores = (int)std::thread::hardware_concurrency()
+		, most = cores > 4 ? cores : 4;
+	const int engines[2] = { CHILD_TABLE_ENGINE, HASH_TABLE_ENGINE };
+	const char *names[2] = { "child", "hash" };
+	printf("%d bytes, %d cores\n", BENCH_IMAGE_SIZE, cores);
+	printf("%-8s %-12s %-10s %-12s %-10s %-10s %s\n", "engine", "threads", "ms", "MB/s", "speedup", "size", "larger");
+
+	for (int engine = 0; engine < 2; engine++) {
+		double single = 1e30;
+		int single_size = 0;
+		for (int run = 0; run < BENCH_RUNS; run++) {
+			double begin = now_ms();
+			LZWCompress compress(image, BENCH_IMAGE_SIZE, 8, engines[engine]);
+			single_size = compress.compress();
+			double end = now_ms();
+			single = std::min(single, end - begin);
+			::free(compress.acquire_buffer(&single_size));
+		}
+		printf("%-8s %-12s %-10.2f %-12.1f %-10s %-10d %s\n", names[engine], "compress", single, (BENCH_IMAGE_SIZE / (double)(1 << 20)) / (single / 1000), "1.00x", single_size, "");
+
+		for (int threads = 1; threads <= most; threads <<= 1) {
+			ThreadPool pool(threads);
+			double best = 1e30;
+			int size = 0;
+			bool same = true;
+			for (int run = 0; run < BENCH_RUNS; run++) {
+				double begin = now_ms();
+				LZWCompress compress(image, BENCH_IMAGE_SIZE, 8, engines[engine]);
+				compress.compress_parallel(&pool, most);
+				double end = now_ms();
+				best = std::min(best, end - begin);
+
+				unsigned char *stream = compress.acquire_buffer(&size);
+				LZWDecompress decompress(stream, size, 8, lzw_engine_max_width(engines[engine]));
+				int decoded_size = 0;
+				decompress.decompress();
+				char *decoded = decompress.acquire_buffer(&decoded_size);
+				same = same && decoded_size == BENCH_IMAGE_SIZE && ::memcmp(decoded, image, BENCH_IMAGE_SIZE) == 0;
+				::free(decoded);
+				::free(stream);
+			}
+			printf("%-8s %-12d %-10.2f %-12.1f %-10.2f %-10d %.2f%%%s\n", names[engine], threads, best, (BENCH_IMAGE_SIZE / (double)(1 << 20)) / (best / 1000), single / best, size,
+				100.0 * (size - single_size) / single_size, same ? "" : "  MISMATCH");
+		}
+	}
+	::free(image);
+}
+
+/*
+Decompresses a BENCH_IMAGE_SIZE image(half photographic and half flat color) with decompress() and with decompress_parallel on pools of 1 thread up to
+one thread per core(at least 4 threads), with the side index kept by the compressor, and prints the time it takes to build the same index with build_index.
+*/
+void bench_indexed_decode(){
+	unsigned char *image = (unsigned char*)::malloc(BENCH_IMAGE_SIZE);
+	make_photographic(image, BENCH_IMAGE_SIZE / 2);
+	make_flat(image + BENCH_IMAGE_SIZE / 2, BENCH_IMAGE_SIZE / 2);
+
+	MyList<lzw_clear_point> index;
+	LZWCompress compress(image, BENCH_IMAGE_SIZE, 8, CHILD_TABLE_ENGINE);
+	compress.set_index(&index);
+	int size = compress.compress();
+	unsigned char *stream = compress.acquire_buffer(&size);
+
+	int cores = (int)std::thread::hardware_concurrency()
+		, most = cores > 4 ? cores : 4;
+	printf("%d bytes in %d bytes, %u clear codes, %d cores\n", BENCH_IMAGE_SIZE, size, index.list_size() - 1, cores);
+	printf("%-12s %-10s %-12s %s\n", "threads", "ms", "MB/s", "speedup");
+
+	double single = 1e30;
+	for (int run = 0; run < BENCH_RUNS; run++) {
+		double begin = now_ms();
+		LZWDecompress decompress(stream, size, 8, GIF_MAX_BYTE_LEN);
+		decompress.decompress();
+		double end = now_ms();
+		single = std::min(single, end - begin);
+		int decoded_size;
+		::free(decompress.acquire_buffer(&decoded_size));
+	}
+	printf("%-12s %-10.2f %-12.1f %s\n", "decompress", single, (BENCH_IMAGE_SIZE / (double)(1 << 20)) / (single / 1000), "1.00x");
+
+	for (int threads = 1; threads <= most; threads <<= 1) {
+		ThreadPool pool(threads);
+		double best = 1e30;
+		bool same = true;
+		for (int run = 0; run < BENCH_RUNS; run++) {
+			double begin = now_ms();
+			LZWDecompress decompress(stream, size, 8, GIF_MAX_BYTE_LEN);
+			decompress.decompress_parallel(&pool, &index);
+			double end = now_ms();
+			best = std::min(best, end - begin);
+
+			int decoded_size;
+			char *decoded = decompress.acquire_buffer(&decoded_size);
+			same = same && decoded_size == BENCH_IMAGE_SIZE && ::memcmp(decoded, image, BENCH_IMAGE_SIZE) == 0;
+			::free(decoded);
+		}
+		printf("%-12d %-10.2f %-12.1f %.2f%s\n", threads, best, (BENCH_IMAGE_SIZE / (double)(1 << 20)) / (best / 1000), single / best, same ? "" : "  MISMATCH");
+	}
+
+	double scan = 1e30;
+	bool same = true;
+	for (int run = 0; run < BENCH_RUNS; run++) {
+		MyList<lzw_clear_point> scanned;
+		double begin = now_ms();
+		LZWDecompress decompress(stream, size, 8, GIF_MAX_BYTE_LEN);
+		decompress.build_index(&scanned);
+		double end = now_ms();
+		scan = std::min(scan, end - begin);
+		same = same && scanned.list_size() == index.list_size();
+		for (unsigned int point = 0; same && point < index.list_size(); point++) {
+			same = scanned[point]->bit_offset == index[point]->bit_offset && scanned[point]->width == index[point]->width
+				&& scanned[point]->output_offset == index[point]->output_offset;
+		}
+	}
+	printf("build_index  %-10.2f %s\n", scan, same ? "" : "  MISMATCH");
+
+	::free(stream);
+	::free(image);
+}
+
+/*
+Compresses the image with each of the max widths and clear policies of the configs, and checks that it decompresses back to the image.
+The clear codes are counted with the side index, which has a point for each of them and one for the end_of_information code.
+*/
+struct clear_config {
+	const char *name;
+	int engine
+		, max_width
+		, clear_policy;
+};
+
+void bench_clear_configs(const char *input, unsigned char *image, int size, const clear_config *configs, int count){
+	for (int i = 0; i < count; i++) {
+		double best = 1e30;
+		int compressed_size = 0
+			, clears = 0;
+		bool same = true;
+		for (int run = 0; run < BENCH_RUNS; run++) {
+			MyList<lzw_clear_point> points;
+			double begin = now_ms();
+			LZWCompress compress(image, size, 8, configs[i].engine);
+			compress.set_max_width(configs[i].max_width);
+			compress.set_clear_policy(configs[i].clear_policy);
+			compress.set_index(&points);
+			compressed_size = compress.compress();
+			double end = now_ms();
+			best = std::min(best, end - begin);
+
+			unsigned char *stream = compress.acquire_buffer(&compressed_size);
+			LZWDecompress decompress(stream, compressed_size, 8, configs[i].max_width);
+			int decoded_size = 0;
+			decompress.decompress();
+			char *decoded = decompress.acquire_buffer(&decoded_size);
+			same = same && decoded_size == size && ::memcmp(decoded, image, size) == 0;
+			clears = (int)points.list_size() - 2;
+			::free(decoded);
+			::free(stream);
+		}
+		printf("%-14s %-22s %-10.2f %-12.1f %-10d %-10.3f %d%s\n", input, configs[i].name, best, (size / (double)(1 << 20)) / (best / 1000), compressed_size,
+			compressed_size * 8.0 / size, clears, same ? "" : "  MISMATCH");
+	}
+}
+
+/*
+Compares the max code widths and the clear policies on photographic and flat color inputs, and on an input that switches between the two every 64KB,
+where a frozen dictionary is the worst, as it only knows the strings of the part of the input that filled it.
+*/
+void bench_clear_policies(){
+	const clear_config configs[] = {
+		{ "hash 32 when-full", HASH_TABLE_ENGINE, MAX_BYTE_LEN, LZW_CLEAR_WHEN_FULL },
+		{ "hash 16 when-full", HASH_TABLE_ENGINE, 16, LZW_CLEAR_WHEN_FULL },
+		{ "hash 16 deferred", HASH_TABLE_ENGINE, 16, LZW_CLEAR_DEFERRED },
+		{ "hash 16 on-ratio", HASH_TABLE_ENGINE, 16, LZW_CLEAR_ON_RATIO },
+		{ "hash 12 when-full", HASH_TABLE_ENGINE, 12, LZW_CLEAR_WHEN_FULL },
+		{ "child 12 when-full", CHILD_TABLE_ENGINE, GIF_MAX_BYTE_LEN, LZW_CLEAR_WHEN_FULL },
+		{ "child 12 deferred", CHILD_TABLE_ENGINE, GIF_MAX_BYTE_LEN, LZW_CLEAR_DEFERRED },
+		{ "child 12 on-ratio", CHILD_TABLE_ENGINE, GIF_MAX_BYTE_LEN, LZW_CLEAR_ON_RATIO },
+		{ "child 10 when-full", CHILD_TABLE_ENGINE, 10, LZW_CLEAR_WHEN_FULL }
+	};
+	const int count = sizeof configs / sizeof configs[0];
+	unsigned char *image = (unsigned char*)::malloc(BENCH_IMAGE_SIZE)
+		, *mixed = (unsigned char*)::malloc(BENCH_IMAGE_SIZE);
+	printf("%-14s %-22s %-10s %-12s %-10s %-10s %s\n", "input", "config", "ms", "MB/s", "size", "bits/byte", "clears");
+
+	make_photographic(image, BENCH_IMAGE_SIZE);
+	bench_clear_configs("photographic", image, BENCH_IMAGE_SIZE, configs, count);
+	for (int i = 0; i < BENCH_IMAGE_SIZE; i += 2 << 16)
+		::memcpy(mixed + i, image + i, std::min(1 << 16, BENCH_IMAGE_SIZE - i));
+
+	make_flat(image, BENCH_IMAGE_SIZE);
+	bench_clear_configs("flat-color", image, BENCH_IMAGE_SIZE, configs, count);
+	for (int i = 1 << 16; i < BENCH_IMAGE_SIZE; i += 2 << 16)
+		::memcpy(mixed + i, image + i, std::min(1 << 16, BENCH_IMAGE_SIZE - i));
+
+	bench_clear_configs("switching", mixed, BENCH_IMAGE_SIZE, configs, count);
+
+	::free(mixed);
+	::free(image);
+}
+
+/*
+Fills the buffer with something that looks like a screen capture of a user interface, flat_percent of it are runs of 64 to 512 pixels of a handful of colors
+(the panels, the buttons and the backgrounds), the rest is the noise of the text, the icons and the anti-aliasing.
+*/
+void make_ui(unsigned char *image, int size, int flat_percent){
+	srand(3);
+	for (int i = 0; i < size;) {
+		int span = 64 + rand() % 449;
+		if (rand() % 100 < flat_percent) {
+			unsigned char color = (unsigned char)(rand() % 8);
+			while (span-- && i < size) image[i++] = color;
+		}
+		else {
+			while (span-- && i < size) image[i++] = (unsigned char)(rand() % 64);
+		}
+	}
+}
+
+/*
+Compresses inputs that are 0% to 100% flat runs with every engine, the runs are where the run fast path of the compressor skips the lookups.
+*/
+void bench_runs(){
+	unsigned char *image = (unsigned char*)::malloc(BENCH_IMAGE_SIZE);
+	const char *names[] = { "HashTable", "CompactTable", "ChildTable" };
+	const int engines[] = { HASH_TABLE_ENGINE, COMPACT_TABLE_ENGINE, CHILD_TABLE_ENGINE };
+	const int percents[] = { 0, 40, 70, 80, 100 };
+	char input[32];
+	printf("%-14s %-14s %-10s %-12s %s\n", "input", "engine", "ms", "MB/s", "compressed");
+
+	for (int p = 0; p < 5; p++) {
+		make_ui(image, BENCH_IMAGE_SIZE, percents[p]);
+		sprintf(input, "%d%% runs", percents[p]);
+		for (int i = 0; i < 3; i++)
+			bench_engine(names[i], input, image, BENCH_IMAGE_SIZE, engines[i]);
+	}
+	::free(image);
+}
+
+/*
+Fills the buffer with a 2048 pixel wide gradient of 16 colors with a 4x4 ordered dither.
+*/
+void make_dithered(unsigned char *image, int size){
+	static const int bayer[4][4] = { { 0, 8, 2, 10 }, { 12, 4, 14, 6 }, { 3, 11, 1, 9 }, { 15, 7, 13, 5 } };
+	for (int i = 0; i < size; i++) {
+		int x = i % 2048
+			, y = i / 2048;
+		image[i] = (unsigned char)(((x * 3 + y) * 16 * 16 / (4 * 2048) + bayer[y & 3][x & 3]) >> 4);
+	}
+}
+
+/*
+Fills the buffer with a 2048 pixel wide image of tiles of stripes, like the textured backgrounds of a user interface, the repeated patterns are where
+the lookahead parsing wins the most.
+*/
+void make_patterned(unsigned char *image, int size){
+	for (int i = 0; i < size; i++) {
+		int x = i % 2048
+			, y = i / 2048;
+		image[i] = (unsigned char)(((x / 12 + y / 12) & 1) ? ((x % 12) < 6 ? 3 : 5) : ((y % 9) < 2 ? 1 : 0));
+	}
+}
+
+/*
+Compresses the image with the greedy parsing and with 1 up to LZW_LOOKAHEAD_MAX codes of lookahead, and checks that the decompressor gives it back.
+*/
+void bench_lookahead_input(const char *input, unsigned char *image, int size){
+	int greedy_size = 0;
+	for (int codes = 0; codes <= LZW_LOOKAHEAD_MAX; codes++) {
+		double best = 1e30;
+		int compressed_size = 0;
+		bool same = true;
+		for (int run = 0; run < BENCH_RUNS; run++) {
+			double begin = now_ms();
+			LZWCompress compress(image, size, 8, CHILD_TABLE_ENGINE);
+			compress.set_lookahead(codes);
+			compressed_size = compress.compress();
+			double end = now_ms();
+			best = std::min(best, end - begin);
+
+			unsigned char *stream = compress.acquire_buffer(&compressed_size);
+			LZWDecompress decompress(stream, compressed_size, 8, GIF_MAX_BYTE_LEN);
+			int decoded_size = 0;
+			decompress.decompress();
+			char *decoded = decompress.acquire_buffer(&decoded_size);
+			same = same && decoded_size == size && ::memcmp(decoded, image, size) == 0;
+			::free(decoded);
+			::free(stream);
+		}
+		if (codes == 0) greedy_size = compressed_size;
+		printf("%-14s %-10d %-10.2f %-12.1f %-10d %+.2f%%%s\n", input, codes, best, (size / (double)(1 << 20)) / (best / 1000), compressed_size,
+			100.0 * (compressed_size - greedy_size) / greedy_size, same ? "" : "  MISMATCH");
+	}
+}
+
+/*
+Compares the greedy parsing with the lookahead parsing on photographic, flat color, screen capture like, dithered and patterned inputs, and then encodes the animated GIF
+with each of them using add_frames on pools of 1 thread up to one thread per core(at least 4 threads), checking that GIFReader decodes every frame back.
+*/
+void bench_lookahead(){
+	unsigned char *image = (unsigned char*)::malloc(BENCH_IMAGE_SIZE);
+	printf("%-14s %-10s %-10s %-12s %-10s %s\n", "input", "lookahead", "ms", "MB/s", "size", "vs greedy");
+	make_photographic(image, BENCH_IMAGE_SIZE);
+	bench_lookahead_input("photographic", image, BENCH_IMAGE_SIZE);
+	make_flat(image, BENCH_IMAGE_SIZE);
+	bench_lookahead_input("flat-color", image, BENCH_IMAGE_SIZE);
+	make_ui(image, BENCH_IMAGE_SIZE, 70);
+	bench_lookahead_input("70% runs", image, BENCH_IMAGE_SIZE);
+	make_dithered(image, BENCH_IMAGE_SIZE);
+	bench_lookahead_input("dithered", image, BENCH_IMAGE_SIZE);
+	make_patterned(image, BENCH_IMAGE_SIZE);
+	bench_lookahead_input("patterned", image, BENCH_IMAGE_SIZE);
+	::free(image);
+
+	const int frame_size = BENCH_FRAME_WIDTH * BENCH_FRAME_HEIGHT;
+	unsigned char *frames = (unsigned char*)::malloc((long long)BENCH_FRAMES * frame_size)
+		, *decoded = (unsigned char*)::malloc(frame_size);
+	gif_frame frame;
+	make_frames(frames, &frame);
+
+	unsigned char palette[3 * 256];
+	make_palette(palette);
+	const unsigned char *pixels[BENCH_FRAMES];
+	gif_frame descriptions[BENCH_FRAMES];
+	for (int i = 0; i < BENCH_FRAMES; i++) {
+		pixels[i] = frames + (long long)i * frame_size;
+		descriptions[i] = frame;
+	}
+
+	int cores = (int)std::thread::hardware_concurrency()
+		, most = cores > 4 ? cores : 4;
+	printf("\n%d frames of %dx%d, %d cores\n", BENCH_FRAMES, BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT, cores);
+	printf("%-10s %-10s %-10s %-12s %-10s %s\n", "lookahead", "threads", "ms", "MB/s", "speedup", "size");
+
+	for (int codes = 0; codes <= LZW_LOOKAHEAD_MAX; codes++) {
+		double single = 0;
+		for (int threads = 1; threads <= most; threads <<= 1) {
+			ThreadPool pool(threads);
+			double best = 1e30;
+			int size = 0;
+			bool same = true;
+			for (int run = 0; run < BENCH_RUNS; run++) {
+				double begin = now_ms();
+				GIFWriter writer(BENCH_FRAME_WIDTH, BENCH_FRAME_HEIGHT, palette, 256, 0);
+				writer.set_lookahead(codes);
+				writer.add_frames(&pool, pixels, descriptions, BENCH_FRAMES);
+				writer.finish();
+				double end = now_ms();
+				best = std::min(best, end - begin);
+
+				unsigned char *gif = writer.acquire_buffer(&size);
+				GIFReader reader(gif, size);
+				for (int i = 0; i < BENCH_FRAMES && same; i++)
+					same = reader.decode_frame(i, decoded, frame_size) && ::memcmp(decoded, pixels[i], frame_size) == 0;
+				::free(gif);
+			}
+			if (threads == 1) single = best;
+			printf("%-10d %-10d %-10.2f %-12.1f %-10.2f %d%s\n", codes, threads, best, ((long long)BENCH_FRAMES * frame_size / (double)(1 << 20)) / (best / 1000),
+				single / best, size, same ? "" : "  MISMATCH");
+		}
+	}
+
+	::free(decoded);
+	::free(frames);
+}
+
+int main(int argc, char *argv[]){
+	const char *help="Usage: ./bench -[w|d|p|r|c|x|m|e|s|a|t|i|l|f|o]\n-w : compare the bit writers at code widths 3-12\n-d : compare the dictionary engines on photographic and flat color inputs\n-p : compare the HashTable probes on a table filled up to HASH_FILL\n-r : print the latency of batches of adds to a growing HashTable\n-c : time the dictionary resets done for the clear codes\n-x : decoder throughput on photographic, flat color and 320x240 frame inputs\n-m : frame-parallel decode of an animated GIF on 1 thread up to one thread per core\n-e : frame-parallel encode of an animated GIF on 1 thread up to one thread per core\n-s : round trip 32x32 icons with new codecs per icon and with codecs that are reset for each icon\n-a : round trip icons and encode an animated GIF with ::malloc, an arena and a thread-local pool allocator\n-t : compress a large image in stripes on 1 thread up to one thread per core\n-i : decompress a large stream in parallel with its clear code index on 1 thread up to one thread per core\n-l : compare the max code widths and the clear policies on photographic, flat color and switching inputs\n-f : compress screen capture like inputs of 0% to 100% flat runs with every engine\n-o : compare the greedy parsing with 1 and 2 codes of lookahead, and encode an animated GIF with each on 1 thread up to one thread per core\n";
+	if(argc!=2
+		|| *argv[1]!='-'
+		|| ::strlen(argv[1]) != 2)
+	{
+		puts(help);
+		exit(-1);
+	}
+	switch(argv[1][1])
+	{
+	case 'w':
+		bench_writer();
+		break;
+	case 'd':
+		bench_dictionary();
+		break;
+	case 'p':
+		bench_probe();
+		break;
+	case 'r':
+		bench_rehash();
+		break;
+	case 'c':
+		bench_clear();
+		break;
+	case 'x':
+		bench_decode();
+		break;
+	case 'm':
+		bench_parallel_decode();
+		break;
+	case 'e':
+		bench_parallel_encode();
+		break;
+	case 's':
+		bench_small_frames();
+		break;
+	case 'a':
+		bench_allocators();
+		break;
+	case 't':
+		bench_stripes();
+		break;
+	case 'i':
+		bench_indexed_decode();
+		break;
+	case 'l':
+		bench_clear_policies();
+		break;
+	case 'f':
+		bench_runs();
+		break;
+	case 'o':
+		bench_lookahead();
+		break;
+	default:
+		puts(help);
+	}
+}
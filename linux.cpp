@@ -5,6 +5,7 @@ This file does not use any licence file, but the author disclaims any interest i
 #include <stdio.h>
 #include "./Headers/LZWCompress.h"
 #include "./Headers/LZWDecompress.h"
+#include "./Headers/GIFContainer.h"
 
 /*
 Returns the size of the file given the file pointer.
@@ -89,8 +90,49 @@ void decompress(){
 	::free(decompressed);
 	::fclose(file);
 }
+/*
+This routine decodes every frame of the data.gif file with the GIFReader and encodes them again to cm.gif with the GIFWriter
+*/
+void gif(){
+	printf("gif uses \"data.gif\" as input file\n");
+
+	GIFReader reader("data.gif");
+	if(!reader.is_valid()){
+		printf("\"data.gif\" is not found or is not a GIF\n");
+		exit(-1);
+	}
+
+	int colors=0;
+	const unsigned char *palette=reader.palette(&colors);
+	GIFWriter writer(reader.width(), reader.height(), palette, colors, reader.loop_count());
+
+	int frames=reader.frame_count();
+	for(int i=0;i<frames;i++){
+		gif_frame frame;
+		reader.frame(i,&frame);
+
+		unsigned char *pixels=(unsigned char*)::malloc(frame.width*frame.height+1);
+		if(!reader.decode_frame(i,pixels,frame.width*frame.height+1))
+			printf("frame %d is broken\n",i);
+		writer.add_frame(pixels,&frame);
+		::free(pixels);
+	}
+
+	int size=writer.finish();
+	unsigned char *encoded=writer.acquire_buffer(&size);
+	printf("%d frames, encoded size is %d\n",frames,size);
+
+	::FILE *file=::fopen("cm.gif","wb");
+	if(::fwrite(encoded,1,size,file)){
+		printf("gif completed\n");
+	}
+
+	::fclose(file);
+	::free(encoded);
+}
+
 int main(int argc, char *argv[]){
-	const char *help="Usage: ./<program-name> -[c|d|b]\n-c : compress the file\n-d : decompress the file\n-b : do compress and decompress both\n";
+	const char *help="Usage: ./<program-name> -[c|d|b|g]\n-c : compress the file\n-d : decompress the file\n-b : do compress and decompress both\n-g : decode and encode again the frames of a GIF\n";
 	if(argc!=2)
 	{
 		puts(help);
@@ -116,6 +158,11 @@ int main(int argc, char *argv[]){
 			decompress();
 			break;
 		}
+		case 'g':
+		{
+			gif();
+			break;
+		}
 		case 'h':
 		{
 			puts(help);
@@ -127,6 +174,6 @@ int main(int argc, char *argv[]){
 	}
 	else
 	{
-		printf("Incorrect syntax for arguments.\nValid arguments are -c, -d ,-b.\nUse -h for help.\n");
+		printf("Incorrect syntax for arguments.\nValid arguments are -c, -d ,-b, -g.\nUse -h for help.\n");
 	}
 }